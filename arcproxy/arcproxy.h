@@ -21,6 +21,7 @@
 #include <thread>
 
 #include <proxy.h>
+#include <proxytrace.h>
 
 #include <stdint.h>
 
@@ -120,12 +121,15 @@ class arcproxy
             if (prev == dropcount)  // refcount zero
             {
                 arc_obj_base* obj = node.reclaim_queue.exchange(nullptr, std::memory_order_acquire);
+                uint64_t count = 0;
                 while (obj != nullptr)
                 {
                     arc_obj_base* obj2 = obj;
                     obj = obj->next;            
                     delete obj2;            
+                    count++;
                 }
+                PROXY_PROBE(arcproxy, reclaim, ndx, count);
                 node.count.store(dword(0, 2), std::memory_order_release);   // return to free list
             }
 
@@ -186,6 +190,7 @@ class arcproxy
         while (!tail.compare_exchange_weak(old_tail, new_tail, std::memory_order_relaxed, std::memory_order_relaxed));
         uint32_t xx = word0(old_tail);
         nodes[old_ndx].count.fetch_add(dword(xx, 0) - 1);
+        PROXY_PROBE(arcproxy, add_tail, old_ndx, new_ndx, xx);
     }
 
 
@@ -0,0 +1,70 @@
+/*
+   Copyright 2024 Joseph W. Seigh
+   
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <type_traits>
+#include <atomic>
+#include <chrono>
+
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+
+/**
+ * futex wait w/ timeout, which std::atomic::wait doesn't have
+ */
+class futex
+{
+public:
+
+    static long _futex(std::atomic<uint32_t>* addr, int op, uint32_t val, const struct timespec* timeout)
+    {
+        return syscall(__NR_futex, (uint32_t*) addr, op, val, timeout, nullptr, 0);
+    }
+
+    /**
+     * wait while *addr == val
+     * @param timeout relative timeout, < 0 wait indefinitely
+     */
+    static void wait(std::atomic<uint32_t>* addr, uint32_t val, std::chrono::nanoseconds timeout)
+    {
+        if (timeout.count() < 0)
+        {
+            _futex(addr, FUTEX_WAIT_PRIVATE, val, nullptr);
+        }
+        else
+        {
+            struct timespec ts;
+            ts.tv_sec = timeout.count() / 1000'000'000;
+            ts.tv_nsec = timeout.count() % 1000'000'000;
+            _futex(addr, FUTEX_WAIT_PRIVATE, val, &ts);
+        }
+    }
+
+    static void wake(std::atomic<uint32_t>* addr, int count)
+    {
+        _futex(addr, FUTEX_WAKE_PRIVATE, count, nullptr);
+    }
+
+};
+
+static_assert(std::is_empty_v<futex>);
+
+/*==*/
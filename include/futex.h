@@ -0,0 +1,2 @@
+#pragma once
+#include "../futex/futex.h"
\ No newline at end of file
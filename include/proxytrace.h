@@ -0,0 +1 @@
+#include <../proxy/proxytrace.h>
\ No newline at end of file
@@ -0,0 +1 @@
+#include <../smrproxy/smrarena.h>
\ No newline at end of file
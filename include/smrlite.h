@@ -0,0 +1 @@
+#include <../smrproxy/smrlite.h>
\ No newline at end of file
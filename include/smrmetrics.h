@@ -0,0 +1 @@
+#include <../smrproxy/smrmetrics.h>
\ No newline at end of file
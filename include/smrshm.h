@@ -0,0 +1 @@
+#include <../smrproxy/smrshm.h>
\ No newline at end of file
@@ -52,6 +52,38 @@ public:
         _membarrier(MB_SYNC, 0, 0);
     }
 
+    /**
+     * register calling process as a target of other processes'
+     * sync_global(), if global expedited is supported
+     * @return 0 or -1 w/ errno set
+     */
+    static int _register_global()
+    {
+        static const int cmd = _global_cmd();
+        if (cmd != MEMBARRIER_CMD_GLOBAL_EXPEDITED)
+            return 0;       // sync_global() doesn't need registration
+        return _membarrier(MEMBARRIER_CMD_REGISTER_GLOBAL_EXPEDITED, 0, 0);
+    }
+
+    /**
+     * memory barrier on all threads of processes registered w/
+     * _register_global(), or on all running threads, much slower,
+     * if global expedited isn't supported
+     */
+    static void sync_global()
+    {
+        static const int cmd = _global_cmd();
+        _membarrier(cmd, 0, 0);
+    }
+
+private:
+
+    static int _global_cmd()
+    {
+        int cmds = _membarrier(MEMBARRIER_CMD_QUERY, 0, 0);
+        return cmds >= 0 && (cmds & MEMBARRIER_CMD_GLOBAL_EXPEDITED) ? MEMBARRIER_CMD_GLOBAL_EXPEDITED : MEMBARRIER_CMD_GLOBAL;
+    }
+
 };
 
 static_assert(std::is_empty_v<membarrier>);
@@ -0,0 +1,48 @@
+/*
+   Copyright 2024 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+/**
+ * USDT static tracepoints for perf and bpftrace, compiled in w/
+ * PROXY_USDT, which needs <sys/sdt.h> (systemtap-sdt-dev).  An
+ * enabled probe is a single nop until attached, w/o PROXY_USDT
+ * probes and their arguments compile away entirely.
+ *
+ *    $ bpftrace -e 'usdt:./proxytest:smrproxy:sync { @[arg1 / 1000] = count(); }'
+ *
+ * smrproxy probes:
+ *    retire(obj, epoch)
+ *    reclaim_start(epoch)              advance at start of reclaim pass
+ *    reclaim_end(epoch, oldest, expired, pending)
+ *    sync(epoch, nsecs)                membarrier, after return
+ *    delete_objects(count, expiry, nsecs)  list of expired objects deleted
+ *
+ * arcproxy probes:
+ *    reclaim(ndx, count)               node refcount dropped to zero
+ *    add_tail(old_ndx, new_ndx, refs)  tail moved to new node
+ *
+ * Arguments must be integers or pointers.
+ */
+#ifdef PROXY_USDT
+    #include <sys/sdt.h>
+    #define PROXY_PROBE(provider, name, ...) STAP_PROBEV(provider, name, ##__VA_ARGS__)
+#else
+    #define PROXY_PROBE(provider, name, ...) do {} while (0)
+#endif
+
+
+/*-*/
@@ -0,0 +1,362 @@
+/*
+   Copyright 2024 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <new>
+#include <utility>
+#include <concepts>
+#include <cstdlib>
+
+#include "smrproxy.h"
+
+#include <stdint.h>
+
+
+/**
+ * Slab of fixed size slots in a size aligned block, so a slot's
+ * slab is found by masking the slot address.  Slots are handed out
+ * by the owning smr_arena only.  Slots freed by delete, i.e. once
+ * smrproxy has expired them, are pushed onto the remote free list
+ * which the owner takes in bulk.  Frees in a reclaim delete pass are
+ * collected per slab and pushed w/ one update of the free list and
+ * live count per slab when the pass ends.
+ *
+ * live is bias - frees while owned, the owner counts allocations
+ * locally and removes the bias on release, so the last of the
+ * owner and the freeing threads destroys the slab.
+ */
+class smr_slab
+{
+    static constexpr uint64_t bias = (uint64_t) 1 << 62;
+
+    struct slot
+    {
+        slot* next;
+    };
+
+    /**
+     * frees of a delete pass on this thread, one run per slab.  A
+     * pass frees mostly objects allocated together, so the last run
+     * is checked first.
+     */
+    struct pass_frees
+    {
+        struct run
+        {
+            smr_slab* slab;
+            slot* head;
+            slot* tail;
+            uint64_t count;
+        };
+
+        static constexpr size_t max_runs = 64;
+        std::vector<run> runs;
+
+        void add(smr_slab* slab, slot* _slot)
+        {
+            auto it = std::find_if(runs.rbegin(), runs.rend(), [slab] (const run& r) { return r.slab == slab; });
+            if (it != runs.rend())
+            {
+                _slot->next = it->head;
+                it->head = _slot;
+                it->count++;
+                return;
+            }
+
+            if (runs.size() == max_runs)
+                flush();
+            _slot->next = nullptr;
+            runs.push_back({slab, _slot, _slot, 1});
+        }
+
+        void flush()
+        {
+            for (run& r : runs)
+                r.slab->push_free(r.head, r.tail, r.count);
+            runs.clear();
+        }
+    };
+
+    inline static thread_local pass_frees _pass_frees;
+
+    std::atomic<slot*> remote_free = nullptr;   // freed slots, any thread
+    std::atomic<uint64_t> live = bias;
+
+    slot* local_free = nullptr;                 // owner only
+    uint64_t allocated = 0;                     // slots handed out, owner only
+    const size_t slot_size;
+    char* bump;                                 // never allocated space
+    char* const end;
+
+    smr_slab(size_t slot_size)
+        : slot_size(slot_size),
+          bump((char*) this + header_size),
+          end((char*) this + size)
+    {}
+
+public:
+
+    static constexpr size_t size = 64 * 1024;
+    static constexpr size_t header_size = 128;  // slots start here, 64 byte aligned
+    static constexpr size_t slot_space = size - header_size;
+
+    static constexpr size_t slot_min = sizeof(slot);
+
+    static smr_slab* create(size_t slot_size)
+    {
+        void* mem = std::aligned_alloc(size, size);
+        if (mem == nullptr)
+            throw std::bad_alloc();
+        return ::new (mem) smr_slab(slot_size);
+    }
+
+    static smr_slab* from(void* ptr)
+    {
+        return (smr_slab*) ((uintptr_t) ptr & ~(uintptr_t) (size - 1));
+    }
+
+    /**
+     * free slot, any thread.  Deferred to the end of the delete
+     * pass if called from one, see smrproxy::delete_objects().
+     */
+    static void free(void* ptr)
+    {
+        smr_slab* slab = from(ptr);
+        slot* _slot = (slot*) ptr;
+        if (_smr_subtree != nullptr)
+        {
+            _pass_frees.add(slab, _slot);
+            _smr_subtree->flush_frees = flush_pass;
+            return;
+        }
+
+        slab->push_free(_slot, _slot, 1);
+    }
+
+    /**
+     * push frees deferred by the delete passes on this thread
+     */
+    static void flush_pass()
+    {
+        _pass_frees.flush();
+    }
+
+    /**
+     * allocate slot, owner only
+     * @return slot or nullptr if slab full
+     */
+    void* take()
+    {
+        if (local_free == nullptr)
+        {
+            if (bump + slot_size <= end)
+            {
+                void* ptr = bump;
+                bump += slot_size;
+                allocated++;
+                return ptr;
+            }
+            local_free = remote_free.exchange(nullptr, std::memory_order_acquire);    // bulk reclaim
+            if (local_free == nullptr)
+                return nullptr;
+        }
+
+        slot* _slot = local_free;
+        local_free = _slot->next;
+        allocated++;
+        return _slot;
+    }
+
+    /**
+     * return slot w/o counting a free, owner only
+     */
+    void untake(void* ptr)
+    {
+        slot* _slot = (slot*) ptr;
+        _slot->next = local_free;
+        local_free = _slot;
+        allocated--;
+    }
+
+    /**
+     * @return true if slot can be allocated w/o a new slab, owner only
+     */
+    bool available() const
+    {
+        return local_free != nullptr
+            || bump + slot_size <= end
+            || remote_free.load(std::memory_order_relaxed) != nullptr;
+    }
+
+    /**
+     * @return true if all allocated slots freed, owner only
+     */
+    bool empty() const
+    {
+        return bias - live.load(std::memory_order_acquire) == allocated;
+    }
+
+    /**
+     * drop owner reference, slab is destroyed by the last free of
+     * any slots still allocated
+     */
+    void release()
+    {
+        unref(bias - allocated);
+    }
+
+private:
+
+    /**
+     * push linked freed slots onto remote free list, any thread
+     */
+    void push_free(slot* head, slot* tail, uint64_t count)
+    {
+        slot* next = remote_free.load(std::memory_order_relaxed);
+        do {
+            tail->next = next;
+        } while (!remote_free.compare_exchange_weak(next, head, std::memory_order_release, std::memory_order_relaxed));
+
+        unref(count);
+    }
+
+    void unref(uint64_t count)
+    {
+        if (live.fetch_sub(count, std::memory_order_acq_rel) == count)
+        {
+            this->~smr_slab();
+            std::free(this);
+        }
+    }
+};
+
+static_assert(sizeof(smr_slab) <= smr_slab::header_size);
+
+
+/**
+ * Base class for smrproxy managed objects allocated from an
+ * smr_arena.  Deleting the object, e.g. by smrproxy once it has
+ * expired, returns its slot to the slab it was allocated from.
+ */
+class smr_arena_obj : public smr_obj_base
+{
+public:
+    static void* operator new(size_t) = delete;     // use smr_arena::create
+    static void operator delete(void* ptr) { smr_slab::free(ptr); }
+};
+
+
+/**
+ * Slab allocator for smrproxy managed objects, one per writer
+ * thread.  create() must only be called by the owning thread,
+ * objects may be deleted by any thread.  Slots freed by reclaim
+ * are reused by the owner in bulk and slabs w/ no allocated
+ * slots are returned to the heap, keeping one spare.
+ *
+ * Slabs w/ objects still pending reclaim when the arena is
+ * destroyed are freed when their last object is deleted.
+ */
+template<typename T>
+    requires std::derived_from<T, smr_arena_obj>
+class smr_arena
+{
+    static_assert(alignof(T) <= 64 && smr_slab::header_size % alignof(T) == 0, "smr_arena slot alignment");
+
+    static constexpr size_t slot_size = (std::max(sizeof(T), smr_slab::slot_min) + alignof(T) - 1) & ~(alignof(T) - 1);
+
+    static_assert(slot_size <= smr_slab::slot_space, "smr_arena object too large for a slab slot");
+
+    std::vector<smr_slab*> slabs;
+    smr_slab* current = nullptr;
+
+public:
+
+    smr_arena() {}
+
+    ~smr_arena()
+    {
+        for (smr_slab* slab : slabs)
+            slab->release();
+    }
+
+    smr_arena(const smr_arena&) = delete;
+    smr_arena& operator=(const smr_arena&) = delete;
+
+    template<typename... Args>
+    T* create(Args&&... args)
+    {
+        void* ptr = current != nullptr ? current->take() : nullptr;
+        if (ptr == nullptr)
+        {
+            current = next_slab();
+            ptr = current->take();
+        }
+
+        try {
+            return ::new (ptr) T(std::forward<Args>(args)...);
+        }
+        catch (...) {
+            current->untake(ptr);
+            throw;
+        }
+    }
+
+    /**
+     * number of slabs held, for testing
+     */
+    size_t slab_count() const { return slabs.size(); }
+
+private:
+
+    /**
+     * find slab w/ free slots, returning empty slabs to heap
+     * beyond one spare, or allocate new slab
+     */
+    smr_slab* next_slab()
+    {
+        smr_slab* found = nullptr;
+        bool spare = false;
+
+        std::erase_if(slabs, [&] (smr_slab* slab) {
+            if (slab->empty() && slab != current)
+            {
+                if (spare)
+                {
+                    slab->release();
+                    return true;
+                }
+                spare = true;
+            }
+            if (found == nullptr && slab->available())
+                found = slab;
+            return false;
+        });
+
+        if (found == nullptr)
+        {
+            found = smr_slab::create(slot_size);
+            slabs.push_back(found);
+        }
+        return found;
+    }
+};
+
+
+/*-*/
@@ -0,0 +1,159 @@
+/*
+   Copyright 2024 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <memory>
+
+#include "smrproxy.h"
+
+#include <stdint.h>
+
+
+/**
+ * Single writer smrproxy variant w/o reclaim thread.
+ *
+ * Same wait-free smr_ref read side as smrproxy.  The single
+ * writer retires onto a plain list and runs a reclaim step
+ * inline every reclaim_interval retires.  Only retire() and
+ * try_reclaim() need to be serialized, acquire_ref() and
+ * release_ref() may be called from any thread.
+ */
+class smrlite
+{
+    epoch_t domain_epoch = 1;
+
+    std::shared_ptr<smr_registry> refs = std::make_shared<smr_registry>();   // reader slots
+
+    const uint32_t reclaim_interval;
+
+    smr_obj_base* head = nullptr;       // retire list
+    uint32_t count = 0;
+
+    /**
+     * objects retired in the same reclaim step, expiry is
+     * monotonic so batches expire in fifo order
+     */
+    struct smr_batch
+    {
+        smr_obj_base* head;
+        epoch_t expiry;
+    };
+
+    std::deque<smr_batch> defer_queue;
+
+public:
+
+    smrlite(uint32_t reclaim_interval) : reclaim_interval(std::max(reclaim_interval, 1u))
+    {
+        membarrier::_register();
+    }
+
+    smrlite() : smrlite(64) {}
+
+    ~smrlite()
+    {
+        delete_objects(head, domain_epoch);
+        for (smr_batch& batch : defer_queue)
+            delete_objects(batch.head, batch.expiry);
+        defer_queue.clear();
+    }
+
+    smr_ref* acquire_ref() {
+        return refs->claim();
+    }
+
+    void release_ref(smr_ref* ref) {
+        refs->release(ref);
+    }
+
+    void retire(smr_obj_base * data) {
+        if (data == nullptr)
+            return;
+
+        data->pre_expiry.store(domain_epoch, std::memory_order_relaxed);
+        data->smr_obj_next = head;
+        head = data;
+
+        if (++count >= reclaim_interval)
+            try_reclaim();
+    }
+
+    /**
+     * reclaim step, called by the writer
+     * @return true if objects pending reclaim
+     */
+    bool try_reclaim() {
+        if (head != nullptr)
+        {
+            epoch_t expiry = domain_epoch;
+            expiry += 2;
+            std::atomic_ref(domain_epoch).store(expiry, std::memory_order_relaxed);
+
+            defer_queue.push_back({head, expiry});
+            head = nullptr;
+            count = 0;
+
+            if constexpr (_smrproxy_mb)
+            {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+            }
+            else
+            {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                membarrier::sync();
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+            }
+        }
+
+        if (defer_queue.empty())
+            return false;
+
+        epoch_t oldest = refs->scan(domain_epoch);
+
+        while (!defer_queue.empty() && defer_queue.front().expiry <= oldest)
+        {
+            delete_objects(defer_queue.front().head, defer_queue.front().expiry);
+            defer_queue.pop_front();
+        }
+
+        return !defer_queue.empty();
+    }
+
+private:
+
+    static void delete_objects(smr_obj_base* head, epoch_t expiry)
+    {
+        smr_obj_base* next = head;
+        while (next != nullptr)
+        {
+            smr_obj_base* _obj = next;
+            next = next->smr_obj_next;
+            _obj->smr_obj_next = nullptr;
+            _obj->expiry.store(expiry, std::memory_order_relaxed);
+            smr_dispose(_obj);
+        }
+    }
+
+};
+
+
+static_assert(ProxyType<smrlite, smr_ref, smr_obj_base>, "smrlite does not meet ProxyType requirement");
+
+
+/*-*/
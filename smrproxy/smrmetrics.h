@@ -0,0 +1,276 @@
+/*
+   Copyright 2024 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <system_error>
+
+#include <cstring>
+
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+inline uint64_t smr_clock_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+/**
+ * Snapshot of a domain's reclaim pipeline, see smrproxy::metrics().
+ * Counters are cumulative since the domain was created, rates come
+ * from the difference of two snapshots, see smr_metrics_rates.
+ * All uint64_t so a snapshot can be copied word by word through a
+ * shared memory stats page.
+ */
+struct smr_metrics
+{
+    static constexpr uint32_t latency_buckets = 32;
+
+    uint64_t timestamp_ns;          // steady clock
+    uint64_t epoch;                 // domain epoch
+    uint64_t epoch_lag;             // epochs oldest reader was behind domain epoch at last pass
+    uint64_t retired;               // objects moved to defer queue
+    uint64_t deleted;               // objects deleted
+    uint64_t outstanding;           // retired - deleted
+    uint64_t outstanding_bytes;     // size hints of retired objects not yet deleted, bounded mode only
+    uint64_t defer_batches;         // defer queue depth
+    uint64_t deferred;              // objects in defer queue
+    uint64_t passes;                // reclaim passes
+    uint64_t scan_ns;               // time in ref scans
+    uint64_t sync_ns;               // time in memory barriers
+    uint64_t delete_ns;             // time deleting expired objects, any thread
+
+    /**
+     * retire to delete latency, log2 histogram weighted by object
+     * count, bucket n counts [2^(n-1), 2^n) microseconds.  Measured
+     * from the first retire of each reclaim batch, so an upper bound
+     * for the batch's other objects.
+     */
+    uint64_t latency[latency_buckets];
+};
+
+static_assert(std::is_trivially_copyable_v<smr_metrics> && sizeof(smr_metrics) % sizeof(uint64_t) == 0);
+
+
+/**
+ * per second rates and per pass times between two snapshots
+ */
+struct smr_metrics_rates
+{
+    double retires = 0;             // per second
+    double deletes = 0;
+    double passes = 0;
+    double scan_ns = 0;             // per pass
+    double sync_ns = 0;
+    double delete_ns = 0;
+
+    smr_metrics_rates(const smr_metrics& before, const smr_metrics& after)
+    {
+        double secs = (after.timestamp_ns - before.timestamp_ns) / 1e9;
+        if (secs > 0)
+        {
+            retires = (after.retired - before.retired) / secs;
+            deletes = (after.deleted - before.deleted) / secs;
+            passes = (after.passes - before.passes) / secs;
+        }
+
+        uint64_t npasses = after.passes - before.passes;
+        if (npasses > 0)
+        {
+            scan_ns = (double) (after.scan_ns - before.scan_ns) / npasses;
+            sync_ns = (double) (after.sync_ns - before.sync_ns) / npasses;
+            delete_ns = (double) (after.delete_ns - before.delete_ns) / npasses;
+        }
+    }
+};
+
+
+/**
+ * Shared memory page for smr_metrics, updated under a seqlock by a
+ * single writer, the domain's reclaim thread, see
+ * smrproxy_config::stats_page.  Read by other processes w/
+ * smr_stats_view.
+ */
+struct smr_stats_layout
+{
+    static constexpr uint64_t magic_value = 0x534d525354415431;    // "SMRSTAT1"
+    static constexpr uint32_t words = sizeof(smr_metrics) / sizeof(uint64_t);
+
+    uint64_t magic;
+    uint32_t size;                          // sizeof(smr_metrics)
+    uint32_t pid;                           // publishing process
+    std::atomic<uint64_t> seq;              // odd while update in progress
+    std::atomic<uint64_t> data[words];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+
+/**
+ * Named POSIX shared memory stats page, created and published to by
+ * the monitored process.  One domain per page.  The name is unlinked
+ * when the page is destroyed.
+ *
+ *    smr_stats_page page("/myapp.smr");
+ *    smrproxy proxy(smrproxy_config{.stats_page = &page});
+ */
+class smr_stats_page
+{
+    std::string name;
+    smr_stats_layout* page;
+
+public:
+
+    smr_stats_page(const char* name) : name(name)
+    {
+        int fd = shm_open(name, O_CREAT | O_RDWR | O_TRUNC, 0644);
+        if (fd < 0)
+            throw std::system_error(errno, std::generic_category(), "shm_open");
+
+        if (ftruncate(fd, sizeof(smr_stats_layout)) != 0)
+        {
+            int err = errno;
+            close(fd);
+            shm_unlink(name);
+            throw std::system_error(err, std::generic_category(), "ftruncate");
+        }
+
+        void* mem = mmap(nullptr, sizeof(smr_stats_layout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mem == MAP_FAILED)
+        {
+            int err = errno;
+            shm_unlink(name);
+            throw std::system_error(err, std::generic_category(), "mmap");
+        }
+
+        page = (smr_stats_layout*) mem;             // zero filled
+        page->size = sizeof(smr_metrics);
+        page->pid = getpid();
+        std::atomic_ref(page->magic).store(smr_stats_layout::magic_value, std::memory_order_release);
+    }
+
+    ~smr_stats_page()
+    {
+        munmap(page, sizeof(smr_stats_layout));
+        shm_unlink(name.c_str());
+    }
+
+    smr_stats_page(const smr_stats_page&) = delete;
+    smr_stats_page& operator=(const smr_stats_page&) = delete;
+
+    void publish(const smr_metrics& metrics)
+    {
+        uint64_t words[smr_stats_layout::words];
+        memcpy(words, &metrics, sizeof(words));
+
+        uint64_t seq = page->seq.load(std::memory_order_relaxed);
+        page->seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (uint32_t ndx = 0; ndx < smr_stats_layout::words; ndx++)
+            page->data[ndx].store(words[ndx], std::memory_order_relaxed);
+        page->seq.store(seq + 2, std::memory_order_release);
+    }
+};
+
+
+/**
+ * Read only mapping of an smr_stats_page, e.g. from a monitoring
+ * process.
+ */
+class smr_stats_view
+{
+    const smr_stats_layout* page = nullptr;
+
+public:
+
+    /**
+     * @throws std::system_error if the page doesn't exist
+     */
+    smr_stats_view(const char* name)
+    {
+        int fd = shm_open(name, O_RDONLY, 0);
+        if (fd < 0)
+            throw std::system_error(errno, std::generic_category(), "shm_open");
+
+        void* mem = mmap(nullptr, sizeof(smr_stats_layout), PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mem == MAP_FAILED)
+            throw std::system_error(errno, std::generic_category(), "mmap");
+        page = (const smr_stats_layout*) mem;
+    }
+
+    ~smr_stats_view()
+    {
+        munmap((void*) page, sizeof(smr_stats_layout));
+    }
+
+    smr_stats_view(const smr_stats_view&) = delete;
+    smr_stats_view& operator=(const smr_stats_view&) = delete;
+
+    pid_t pid() const { return page->pid; }
+
+    /**
+     * consistent copy of the last published snapshot
+     * @return false if nothing published yet, page layout doesn't
+     * match, or no consistent copy after retries, e.g. publisher
+     * died mid update
+     */
+    bool read(smr_metrics& metrics) const
+    {
+        if (std::atomic_ref(const_cast<uint64_t&>(page->magic)).load(std::memory_order_acquire) != smr_stats_layout::magic_value
+            || page->size != sizeof(smr_metrics))
+            return false;
+
+        uint64_t words[smr_stats_layout::words];
+        for (uint32_t retries = 0; retries < 1000; retries++)
+        {
+            uint64_t seq = page->seq.load(std::memory_order_acquire);
+            if (seq == 0)
+                return false;
+            if (seq & 1)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            for (uint32_t ndx = 0; ndx < smr_stats_layout::words; ndx++)
+                words[ndx] = page->data[ndx].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (page->seq.load(std::memory_order_relaxed) == seq)
+            {
+                memcpy(&metrics, words, sizeof(words));
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+
+/*-*/
@@ -22,16 +22,37 @@
 #include <condition_variable>
 #include <latch>
 #include <vector>
+#include <deque>
 #include <memory>
+#include <functional>
+#include <algorithm>
+#include <type_traits>
+#include <concepts>
+#include <coroutine>
+#include <utility>
+#include <chrono>
+#include <string>
+#include <array>
+#include <bit>
+#include <stdexcept>
 
 #include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
 #include "epoch.h"
+#include "smrmetrics.h"
 
 #include <proxy.h>
+#include <proxytrace.h>
 #include <membarrier.h>
+#include <futex.h>
 
 #include <stdint.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/syscall.h>
 
 
 #ifndef SMRPROXY_MB
@@ -40,17 +61,157 @@
     constexpr bool _smrproxy_mb = true;        // no global memory barrier, local memory barriers required
 #endif
 
+#ifndef SMRPROXY_PROFILE
+    constexpr bool _smrproxy_profile = false;
+#else
+    constexpr bool _smrproxy_profile = true;   // sample reader lock hold times
+#endif
+
 
 class smr_ref;
 class smrproxy;
 class smrexpiry;
+class smr_slots;
+class smr_registry;
+class smr_reclaimer;
+
+/**
+ * executor for deleting expired objects or resuming coroutines
+ */
+using smr_executor = std::function<void(std::function<void()>)>;
+
+
+/**
+ * Reclaim thread wake up, shared by the domain's reclaim thread,
+ * writers, and readers.  Writers only wake an idle reclaim thread,
+ * readers only when unlocking the epoch reclaim is waiting on.
+ * The state exchange coalesces wake ups, so at most one futex wake
+ * per reclaim thread sleep.
+ */
+struct smr_wakeup
+{
+    static constexpr uint32_t awake = 0;
+    static constexpr uint32_t polling = 1;      // timed wait, backlog pending
+    static constexpr uint32_t idle = 2;         // wait until woken, nothing pending
+
+    std::atomic<uint32_t> state = awake;
+    std::atomic<uint32_t> seq = 0;              // futex word
+
+    inline void wake()
+    {
+        if (state.exchange(awake, std::memory_order_seq_cst) != awake)
+        {
+            seq.fetch_add(1, std::memory_order_release);
+            futex::wake(&seq, 1);
+        }
+    }
+
+    /**
+     * wake only if reclaim is polling or idle, the load keeps readers
+     * unlocking at the hint epoch off the line once one of them has
+     * woken reclaim.  A stale awake only delays reclaim to its poll,
+     * the hint is only set while reclaim is polling.
+     */
+    inline void wake_waiting()
+    {
+        if (state.load(std::memory_order_relaxed) != awake)
+            wake();
+    }
+
+    /**
+     * unconditional wake
+     */
+    void wake_all()
+    {
+        seq.fetch_add(1, std::memory_order_seq_cst);
+        futex::wake(&seq, INT32_MAX);
+    }
+};
+
+inline smr_wakeup _smr_no_wakeup;          // for refs not in a registry
+inline std::atomic<epoch_t> _smr_no_hint{0};
+inline std::atomic<epoch_t> _smr_no_epoch{1};
+
+inline thread_local pid_t _smr_tid = 0;
+
+inline pid_t smr_gettid()
+{
+    if (_smr_tid == 0)
+        _smr_tid = gettid();
+    return _smr_tid;
+}
+
+
+/**
+ * Log2 histogram of sampled reader lock hold times, bucket n
+ * counts hold times in [2^(n-1), 2^n) nanoseconds.  Only
+ * recorded when compiled w/ SMRPROXY_PROFILE.
+ */
+struct smr_hold_histogram
+{
+    static constexpr uint32_t buckets = 40;
+    static constexpr uint32_t sample_rate = 64;     // sample every nth lock per slot
+
+    std::atomic<uint64_t> counts[buckets] = {};
+
+    void record(uint64_t nsecs)
+    {
+        counts[std::min<uint32_t>(std::bit_width(nsecs), buckets - 1)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::array<uint64_t, buckets> snapshot() const
+    {
+        std::array<uint64_t, buckets> values;
+        for (uint32_t ndx = 0; ndx < buckets; ndx++)
+            values[ndx] = counts[ndx].load(std::memory_order_relaxed);
+        return values;
+    }
+};
+
+inline smr_hold_histogram _smr_no_histogram;
+
+/**
+ * per slot hold time sampling, SMRPROXY_PROFILE only
+ */
+class smr_ref_profile
+{
+    uint32_t count = 0;
+    uint64_t start = 0;                     // sampled lock time, 0 = not sampled
+    smr_hold_histogram* histogram = &_smr_no_histogram;
+
+public:
+
+    void set_histogram(smr_hold_histogram* histogram) { this->histogram = histogram; }
+
+    inline void on_lock()
+    {
+        if (++count % smr_hold_histogram::sample_rate == 0) [[unlikely]]
+            start = smr_clock_ns();
+    }
+
+    inline void on_unlock()
+    {
+        if (start != 0) [[unlikely]]
+        {
+            histogram->record(smr_clock_ns() - start);
+            start = 0;
+        }
+    }
+};
+
+struct smr_no_profile
+{
+    void set_histogram(smr_hold_histogram*) {}
+    void on_lock() {}
+    void on_unlock() {}
+};
 
 class smr_obj_base
 {
 public:
     smr_obj_base * smr_obj_next = nullptr;
 
-    std::atomic<epoch_t> expiry;            // set to expiry epoch by reclaim
+    std::atomic<epoch_t> expiry;            // set to batch expiry epoch when deleted
 
     /**
      * set on call to retire
@@ -60,6 +221,10 @@ public:
 
     bool deleted = false;
 
+    bool smr_counted = false;               // derived from smr_obj_counted
+
+    uint32_t smr_obj_size = 0;              // retire size hint, bounded mode
+
     smr_obj_base() {
         expiry.store(0, std::memory_order_relaxed);
         pre_expiry.store(0, std::memory_order_relaxed);
@@ -74,56 +239,232 @@ public:
     }
 };
 
+/**
+ * Side allocated block of retired pointers w/ deleters, for
+ * objects not derived from smr_obj_base.  The block is retired
+ * as a single smr_obj_base, deleting it runs the deleters.
+ */
+class smr_retire_block : public smr_obj_base
+{
+public:
+    using deleter_t = void (*)(void*);
+
+    static constexpr uint32_t capacity = 60;    // block fits in 1KB
+
+    struct entry
+    {
+        void* ptr;
+        deleter_t deleter;
+    };
+
+    uint32_t count = 0;
+    uint64_t bytes = 0;                     // sum of size hints, bounded mode
+    entry entries[capacity];
+
+    bool full() const { return count >= capacity; }
+
+    void add(void* ptr, deleter_t deleter, size_t size)
+    {
+        entries[count++] = {ptr, deleter};
+        bytes += size;
+    }
+
+    ~smr_retire_block()
+    {
+        for (uint32_t ndx = 0; ndx < count; ndx++)
+            entries[ndx].deleter(entries[ndx].ptr);
+    }
+};
+
+static_assert(sizeof(smr_retire_block) <= 1024);
+
+/**
+ * Deferred callback, run when deleted after a grace period.
+ */
+class smr_callback : public smr_obj_base
+{
+    std::function<void()> fn;
+
+public:
+    smr_callback(std::function<void()> fn) : fn(std::move(fn)) {}
+
+    ~smr_callback()
+    {
+        fn();
+    }
+};
+
+/**
+ * Base class for managed objects readers can keep past their read
+ * lock w/ an smr_handle, e.g. to hand to an async I/O completion.
+ * Once the retired object expires, reclaim drops the domain's
+ * reference instead of deleting it, and the object is deleted when
+ * the last handle is dropped.
+ */
+class smr_obj_counted : public smr_obj_base
+{
+    template<typename T>
+        requires std::derived_from<T, smr_obj_counted>
+    friend class smr_handle;
+
+    std::atomic<uint64_t> smr_refs = 1;         // domain's reference + handles
+
+public:
+
+    smr_obj_counted() {
+        smr_counted = true;
+    }
+
+    /**
+     * drop a reference, deleting the object if it was the last
+     */
+    void smr_release()
+    {
+        if (smr_refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            delete this;
+    }
+};
+
+/**
+ * delete expired object, or drop the domain's reference to a counted one
+ */
+inline void smr_dispose(smr_obj_base* obj)
+{
+    if (obj->smr_counted)
+        static_cast<smr_obj_counted*>(obj)->smr_release();
+    else
+        delete obj;
+}
+
+/**
+ * Counted handle to an smr_obj_counted object.  Promoting a pointer
+ * loaded under a read lock keeps the object alive after unlock, w/o
+ * holding back reclaim of other objects.
+ *
+ *    smr_handle<conn> h;
+ *    {
+ *        std::scoped_lock m(proxy);
+ *        h = smr_handle<conn>(table.lookup(key));
+ *    }
+ *    submit_io(std::move(h));
+ */
+template<typename T>
+    requires std::derived_from<T, smr_obj_counted>
+class smr_handle
+{
+    T* obj = nullptr;
+
+public:
+
+    smr_handle() {}
+
+    /**
+     * @param obj object protected by the caller's read lock or another
+     * handle, or nullptr
+     */
+    explicit smr_handle(T* obj) : obj(obj)
+    {
+        if (obj != nullptr)
+            obj->smr_refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    smr_handle(const smr_handle& other) : smr_handle(other.obj) {}
+
+    smr_handle(smr_handle&& other) noexcept : obj(std::exchange(other.obj, nullptr)) {}
+
+    smr_handle& operator=(smr_handle other) noexcept
+    {
+        std::swap(obj, other.obj);
+        return *this;
+    }
+
+    ~smr_handle()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        if (obj != nullptr)
+            std::exchange(obj, nullptr)->smr_release();
+    }
+
+    T* get() const { return obj; }
+    T* operator->() const { return obj; }
+    T& operator*() const { return *obj; }
+    explicit operator bool() const { return obj != nullptr; }
+};
+
 class alignas(64) smr_ref
 {
     friend class smrproxy;
     friend class smrexpiry;
+    friend class smr_slots;
+    friend class smr_registry;
 
     smr_ref(smr_ref&) = delete;     // no copy
     smr_ref(smr_ref&&) = delete;    // no move
     smr_ref& operator=(smr_ref&&) = delete; 
 
 
-    std::atomic<epoch_t> _ref_epoch;        // set by lock() from shadow_epoch, by unlock() to 0, read by reclaim
+    /**
+     * set by lock() from the registry's published epoch, by unlock()
+     * to 0, read by reclaim.  Reclaim never writes a claimed slot's
+     * line, reclaim private state is kept in smr_slots.
+     */
+    std::atomic<epoch_t> _ref_epoch;
+
+    const std::atomic<epoch_t>* _epoch = &_smr_no_epoch;   // published epoch, read-mostly shared line
 
-    std::atomic<epoch_t>  shadow_epoch;     // set by reclaim thread, read by reader thread lock()
+    smr_wakeup* _wakeup = &_smr_no_wakeup;  // domain wake up, for unlock hint
+    const std::atomic<epoch_t>* _hint_epoch = &_smr_no_hint;
 
-    epoch_t effective_epoch;                // set and read by reclaim thread -- not atomic
+    uint32_t _index = 0;                    // slot index in node's slots
+    uint16_t _node = 0;                     // NUMA node of slots
+    std::atomic<uint32_t> _next_free = 0;   // free stack link, slot index + 1, 0 = end of stack
+    std::atomic<pid_t> _owner_tid = 0;      // thread that claimed slot, for stall watchdog
+    std::atomic_bool _claimed{false};       // slot in use
+
+    [[no_unique_address]] std::conditional_t<_smrproxy_profile, smr_ref_profile, smr_no_profile> _profile;
 
 public:
 
-    smr_ref(epoch_t epoch) {
+    smr_ref() {
         _ref_epoch.store(0);
-        shadow_epoch = epoch;
-        effective_epoch = epoch;
     }
 
-    ~smr_ref()
-    {
-        print();
-    }
+    ~smr_ref() {}
 
 
     inline void lock()
     {
         if constexpr(_smrproxy_mb)
         {
-            epoch_t _epoch = shadow_epoch.load(std::memory_order_relaxed);
-            _ref_epoch.store(_epoch, std::memory_order_seq_cst);
-            // _ref_epoch.store(_epoch, std::memory_order_relaxed);
+            epoch_t epoch = _epoch->load(std::memory_order_relaxed);
+            _ref_epoch.store(epoch, std::memory_order_seq_cst);
+            // _ref_epoch.store(epoch, std::memory_order_relaxed);
             // std::atomic_thread_fence(std::memory_order_seq_cst);
         }
         else
         {
-            epoch_t _epoch = shadow_epoch.load(std::memory_order_relaxed);
-            _ref_epoch.store(_epoch, std::memory_order_relaxed);
+            epoch_t epoch = _epoch->load(std::memory_order_relaxed);
+            _ref_epoch.store(epoch, std::memory_order_relaxed);
             std::atomic_signal_fence(std::memory_order_seq_cst);
         }
+
+        _profile.on_lock();
     }
 
     inline void unlock()
     {
+        _profile.on_unlock();
+
+        epoch_t epoch = _ref_epoch.load(std::memory_order_relaxed);
         _ref_epoch.store(0, std::memory_order_release);
+
+        // last reader(s) pinning oldest epoch w/ pending reclaim, hint 0 = none
+        if (epoch != 0 && epoch == _hint_epoch->load(std::memory_order_relaxed)) [[unlikely]]
+            _wakeup->wake_waiting();
     }
 
     /**
@@ -146,230 +487,2595 @@ public:
             _ref_epoch.store(pre_expiry, std::memory_order_relaxed);
     }
 
+    /**
+     * Move a locked ref's epoch forward while at obj in a long
+     * traversal, see smr_cursor.  Advances to obj's retire epoch if
+     * obj is retired, else to the current epoch.  Afterwards only obj
+     * and objects reached from it are protected.
+     */
+    void advance_epoch(const smr_obj_base* obj)
+    {
+        epoch_t ref_epoch = _ref_epoch.load(std::memory_order_relaxed);
+        if (ref_epoch == 0)
+            return; // not locked
+
+        // objects retired before epoch was published have pre_expiry visible
+        epoch_t epoch = _epoch->load(std::memory_order_acquire);
+        epoch_t pre_expiry = obj->pre_expiry.load(std::memory_order_relaxed);
+        if (pre_expiry != 0)
+            epoch = pre_expiry;
+
+        if (epoch > ref_epoch)
+        {
+            if constexpr(_smrproxy_mb)
+                _ref_epoch.store(epoch, std::memory_order_seq_cst);
+            else
+            {
+                _ref_epoch.store(epoch, std::memory_order_relaxed);
+                std::atomic_signal_fence(std::memory_order_seq_cst);
+            }
+        }
+    }
+
 
     void print() {
-        fprintf(stdout, "effective_epoch=%lu shadow=%lu, _ref=%lu\n",
-            effective_epoch,
-            shadow_epoch.load(std::memory_order_relaxed),
+        fprintf(stdout, "epoch=%lu, _ref=%lu\n",
+            _epoch->load(std::memory_order_relaxed),
             _ref_epoch.load(std::memory_order_relaxed),
             1);
     }
 
 };
 
-class smrproxy
-{
-    epoch_t domain_epoch = 1;
-
-    std::vector<smr_ref *> refs = std::vector<smr_ref *>();
-
-    std::thread reclaim_task;
 
-    std::mutex mutex;
-    std::condition_variable_any cvar;
-    std::chrono::milliseconds wait_ms;
+static_assert(_smrproxy_profile || sizeof(smr_ref) == 64, "smr_ref should fit a cache line");
 
-    std::atomic_bool active{true};             //
 
-    std::atomic<smr_obj_base *> tail = nullptr;     // retire queue
-    std::vector<smr_obj_base *> defer_queue;        // ...
+/**
+ * NUMA topology from sysfs, w/o libnuma
+ */
+struct smr_numa
+{
+    /**
+     * @return ids of online nodes w/ cpus, empty if sysfs has none
+     */
+    static std::vector<uint32_t> nodes()
+    {
+        std::vector<uint32_t> ids;
+        if (FILE* file = fopen("/sys/devices/system/node/online", "r"))
+        {
+            char list[256];
+            if (fgets(list, sizeof(list), file) != nullptr)
+                for_each_cpu(list, [&ids] (uint32_t node) {
+                    cpu_set_t set;
+                    if (ids.size() < UINT16_MAX && cpus(node, &set))
+                        ids.push_back(node);
+                });
+            fclose(file);
+        }
+        return ids;
+    }
 
-public:
+    /**
+     * @return node of cpu calling thread is running on
+     */
+    static uint32_t current_node()
+    {
+        unsigned cpu = 0;
+        unsigned node = 0;
+        if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0)
+            return 0;
+        return node;
+    }
 
-    smrproxy(uint32_t wait_ms)
+    /**
+     * restrict calling thread to node's cpus
+     * @return false if node has no cpus
+     */
+    static bool bind(uint32_t node)
     {
-        this->wait_ms = std::chrono::milliseconds(wait_ms);
-        membarrier::_register();
-        reclaim_task = std::thread([this] () { this->reclaim(); });
+        cpu_set_t set;
+        return cpus(node, &set) && sched_setaffinity(0, sizeof(set), &set) == 0;
     }
 
-    smrproxy() : smrproxy(50) {}
+private:
 
-    ~smrproxy()
+    /**
+     * node's cpus from its sysfs cpulist
+     * @return false if node has no cpus
+     */
+    static bool cpus(uint32_t node, cpu_set_t* set)
     {
-        active.store(false);
-        {
-            std::scoped_lock m(mutex);
-            cvar.notify_all();
-        }
+        CPU_ZERO(set);
 
-        reclaim_task.join();
+        char path[64];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist", node);
+        FILE* file = fopen(path, "r");
+        if (file == nullptr)
+            return false;
 
-        std::for_each(this->refs.begin(), this->refs.end(), [] (smr_ref* ref) { ref->print(); });
-        refs.clear();
-        try_reclaim();              // _try_reclaim?
+        char list[4096];
+        if (fgets(list, sizeof(list), file) != nullptr)
+            for_each_cpu(list, [set] (uint32_t cpu) { if (cpu < CPU_SETSIZE) CPU_SET(cpu, set); });
+        fclose(file);
 
-        smr_obj_base* _tail = tail.exchange(nullptr);
-        if (_tail != nullptr)
+        return CPU_COUNT(set) != 0;
+    }
+
+    /**
+     * apply fn to each number in a sysfs list, e.g. "0-3,8-11"
+     */
+    template<typename F>
+    static void for_each_cpu(const char* list, F&& fn)
+    {
+        const char* p = list;
+        while (*p >= '0' && *p <= '9')
         {
-            fprintf(stderr, "return queue not null\n");
-                delete_objects(_tail);
-        }
-        delete_objects(_tail);
-        if (!defer_queue.empty()) {
-            fprintf(stderr, "defer queue size = %d\n", defer_queue.size());
-            std::for_each(defer_queue.begin(), defer_queue.end(), [] (smr_obj_base* obj)
-            {
-                delete_objects(obj);
-            });
-            defer_queue.clear();
+            char* end;
+            uint32_t first = strtoul(p, &end, 10);
+            uint32_t last = first;
+            if (*end == '-')
+                last = strtoul(end + 1, &end, 10);
+            for (uint32_t n = first; n <= last; n++)
+                fn(n);
+            p = *end == ',' ? end + 1 : end;
         }
-
     }
+};
 
-    smr_ref* acquire_ref() {
-        std::scoped_lock m(mutex);
 
-        smr_ref *ref = new smr_ref(domain_epoch);
-        refs.push_back(ref);
-        return ref;
-    }
+/**
+ * Reader slots of one NUMA node, see smr_registry.
+ *
+ * Slots are preallocated in blocks which are never moved or freed
+ * while the registry exists, so smr_ref pointers remain valid.
+ * Block n holds (_block0 << n) slots.  Free slots are kept on a
+ * lock-free stack of slot indices, tagged to avoid ABA, so claiming
+ * and releasing a slot never takes the domain mutex.
+ *
+ * Released slots keep being scanned as idle refs.  Reclaim's per
+ * slot state, the effective epochs, is kept apart from the slots,
+ * which are only written by their readers.
+ */
+class smr_slots
+{
+    static constexpr uint32_t _block0 = 64;         // size of first block
+    static constexpr uint32_t _max_blocks = 24;     // 64 * (2^24 - 1) slots
 
-    void release_ref(smr_ref* ref) {
-        std::scoped_lock m(mutex);
+    std::atomic<smr_ref*> blocks[_max_blocks] = {};
 
-        std::erase_if(refs, [ref] (smr_ref* ref2) { return ref == ref2; });
-    }
+    std::atomic<uint64_t> free_head = 0;    // tag (32) | slot index + 1 (32)
 
-    void retire(smr_obj_base * data) {
-        if (data == nullptr)
-            return;
+    std::atomic<uint32_t> hwm = 0;          // high water mark, 1 + highest claimed slot index
 
-        epoch_t pre_expiry = std::atomic_ref(domain_epoch).load(std::memory_order_relaxed);   // TODO not actually atomic
-        data->pre_expiry.store(pre_expiry, std::memory_order_relaxed);
+    std::vector<uint64_t> effective;        // effective epoch by slot index, scan() only
 
-        smr_obj_base* next;
-        do {
-            data->smr_obj_next = next = tail.load(std::memory_order_relaxed);
-        } while (!tail.compare_exchange_weak(next, data, std::memory_order_release));
+    // registry's, for new slots
+    const std::atomic<epoch_t>* const epoch;
+    smr_wakeup* const wakeup;
+    const std::atomic<epoch_t>* const hint_epoch;
+    smr_hold_histogram* const hold_times;
+    const uint16_t node;
 
-        if (next == nullptr)
-        {
-            // std::scoped_lock m(mutex);  // ?
-            cvar.notify_all();
-        }
-    }
+    static uint64_t _head(uint32_t tag, uint32_t ndx) { return ((uint64_t) tag << 32) | ndx; }
+    static uint32_t _tag(uint64_t head) { return head >> 32; }
+    static uint32_t _ndx(uint64_t head) { return (uint32_t) head; }
 
-private:
+    static uint32_t block_ndx(uint32_t ndx) { return 63 - __builtin_clzll((ndx / _block0) + 1); }
+    static uint32_t block_base(uint32_t block) { return _block0 * ((1u << block) - 1); }
+    static uint32_t block_size(uint32_t block) { return _block0 << block; }
 
-    /**
-     * delete linked list of objects
-     * @param head head of null terminated linked list
-     */
-    static void delete_objects(smr_obj_base* head)
+    smr_ref* slot(uint32_t ndx)
     {
-        smr_obj_base* next = head;
-        while (next != nullptr)
-        {
-            smr_obj_base* _obj = next;
-            next = next->smr_obj_next;
-            _obj->smr_obj_next = nullptr;
-            delete _obj;
-        }
+        uint32_t block = block_ndx(ndx);
+        return &blocks[block].load(std::memory_order_acquire)[ndx - block_base(block)];
     }
 
-    static void set_expiry(smr_obj_base* head, epoch_t expiry)
+    void push_free(smr_ref* ref)
     {
-        smr_obj_base* next = head;
-        while (next != nullptr)
+        uint64_t head = free_head.load(std::memory_order_relaxed);
+        do {
+            ref->_next_free.store(_ndx(head), std::memory_order_relaxed);
+        } while (!free_head.compare_exchange_weak(head, _head(_tag(head) + 1, ref->_index + 1), std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    smr_ref* pop_free()
+    {
+        uint64_t head = free_head.load(std::memory_order_acquire);
+        while (_ndx(head) != 0)
         {
-            next->expiry.store(expiry, std::memory_order_relaxed);
-            next = next->smr_obj_next;
+            smr_ref* ref = slot(_ndx(head) - 1);
+            uint32_t next = ref->_next_free.load(std::memory_order_relaxed);
+            if (free_head.compare_exchange_weak(head, _head(_tag(head) + 1, next), std::memory_order_acquire, std::memory_order_acquire))
+                return ref;
         }
+        return nullptr;
     }
 
-
     /**
-     * @brief try reclaim, mutex must be held
-     * @return 
+     * add a new block of slots
+     * @return claimed slot from new block or nullptr if another thread added the block
      */
-    bool _try_reclaim() {
-        smr_obj_base* _tail = tail.exchange(nullptr, std::memory_order_acquire);
-        if (_tail != nullptr)
+    smr_ref* grow()
+    {
+        for (uint32_t block = 0; block < _max_blocks; block++)
         {
-            domain_epoch += 2;
-            const epoch_t expiry = domain_epoch;
+            if (blocks[block].load(std::memory_order_acquire) != nullptr)
+                continue;
 
-            // _tail->expiry.store(expiry, std::memory_order_relaxed);
-            set_expiry(_tail, expiry);
-            defer_queue.push_back(_tail);
+            const uint32_t base = block_base(block);
+            const uint32_t size = block_size(block);
 
-            if constexpr (_smrproxy_mb)
+            smr_ref* slots = new smr_ref[size];
+            for (uint32_t ndx = 0; ndx < size; ndx++)
             {
-                std::atomic_thread_fence(std::memory_order_seq_cst);    // needed?
+                slots[ndx]._index = base + ndx;
+                slots[ndx]._node = node;
+                slots[ndx]._epoch = epoch;
+                slots[ndx]._wakeup = wakeup;
+                slots[ndx]._hint_epoch = hint_epoch;
+                slots[ndx]._profile.set_histogram(hold_times);
             }
-            else
+
+            smr_ref* expected = nullptr;
+            if (!blocks[block].compare_exchange_strong(expected, slots, std::memory_order_release, std::memory_order_acquire))
             {
-                std::atomic_thread_fence(std::memory_order_seq_cst);
-                membarrier::sync();
-                std::atomic_thread_fence(std::memory_order_seq_cst);
+                delete[] slots;
+                return nullptr;         // lost race, retry free stack
             }
-        }
 
-        /*
-        * set ref effective epochs and
-        * find oldest referenced epoch
-        */
+            // keep first slot, lowest indices on top of free stack
+            for (uint32_t ndx = size - 1; ndx > 0; ndx--)
+                push_free(&slots[ndx]);
+
+            return &slots[0];
+        }
 
-        const epoch_t current_epoch = domain_epoch;
-        epoch_t oldest = domain_epoch;
+        fprintf(stderr, "smr_slots: out of reader slots\n");
+        abort();
+    }
 
+public:
 
-        std::for_each(this->refs.begin(), this->refs.end(), [current_epoch, &oldest] (smr_ref * ref) {
-            ref->shadow_epoch.store(current_epoch, std::memory_order_relaxed);
-            epoch_t ref_epoch = ref->_ref_epoch.load(std::memory_order_relaxed);
-            if (ref_epoch == 0)
-                ref->effective_epoch = current_epoch;                       // current epoch
-            else if (ref_epoch > ref->effective_epoch) 
-                ref->effective_epoch = ref_epoch;
+    smr_slots(const std::atomic<epoch_t>* epoch, smr_wakeup* wakeup, const std::atomic<epoch_t>* hint_epoch, smr_hold_histogram* hold_times, uint16_t node)
+        : epoch(epoch), wakeup(wakeup), hint_epoch(hint_epoch), hold_times(hold_times), node(node) {}
 
-            if (ref->effective_epoch < oldest)
-                oldest = ref->effective_epoch;
-        });
+    ~smr_slots()
+    {
+        for (uint32_t block = 0; block < _max_blocks; block++)
+            delete[] blocks[block].load(std::memory_order_relaxed);
+    }
 
-        /**
-         * 
-         */
-        auto expired = [this, &oldest]  (smr_obj_base* obj)
+    /**
+     * claim a free reader slot
+     */
+    smr_ref* claim()
+    {
+        smr_ref* ref;
+        while ((ref = pop_free()) == nullptr)
         {
-            if (obj->expiry.load(std::memory_order_relaxed) > oldest)     // obj->expiry > oldest
-            {
-                return false;                           // retain in defer_queue
-            }
-            else // expiry <= oldest
-            {
-                delete_objects(obj);
-                return true;                            // remove from defer_queue
-            }
-        };
+            if ((ref = grow()) != nullptr)
+                break;
+        }
 
-        std::erase_if(defer_queue, expired);
+        uint32_t _hwm = hwm.load(std::memory_order_relaxed);
+        while (_hwm <= ref->_index && !hwm.compare_exchange_weak(_hwm, ref->_index + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            ;
 
-        return !defer_queue.empty();    // per ProxyType requirement
+        ref->_owner_tid.store(smr_gettid(), std::memory_order_relaxed);
+        ref->_claimed.store(true, std::memory_order_relaxed);
+        return ref;
     }
 
-    public:
-
-    bool try_reclaim() {
-        std::scoped_lock(this->mutex);
-        return _try_reclaim();
-    }
+    /**
+     * return reader slot to free stack, slot should be unlocked
+     */
+    void release(smr_ref* ref)
+    {
+        ref->_ref_epoch.store(0, std::memory_order_release);
+        ref->_claimed.store(false, std::memory_order_relaxed);
+        push_free(ref);
+    }
+
+    /**
+     * apply fn to every slot up to the high water mark, claimed or not
+     */
+    template<typename F>
+    void for_each(F&& fn)
+    {
+        const uint32_t limit = hwm.load(std::memory_order_acquire);
+        for (uint32_t block = 0; block < _max_blocks && block_base(block) < limit; block++)
+        {
+            smr_ref* slots = blocks[block].load(std::memory_order_acquire);
+            if (slots == nullptr)
+                break;
+
+            const uint32_t count = std::min(block_size(block), limit - block_base(block));
+            for (uint32_t ndx = 0; ndx < count; ndx++)
+                fn(&slots[ndx]);
+        }
+    }
+
+    /**
+     * set slot effective epochs and find oldest referenced epoch.  Only
+     * reads the slots, effective epochs are kept in a separate array so
+     * reclaim never writes a reader's cache line.  Scalar, the loop is
+     * bound by loading one slot line per reader, which a vectorized
+     * reduction over the effective epochs doesn't save.
+     * @param current_epoch current domain epoch, already published
+     * @return oldest referenced epoch
+     */
+    epoch_t scan(const epoch_t current_epoch)
+    {
+        const uint32_t limit = hwm.load(std::memory_order_acquire);
+        // new slots, 0 so a locked epoch, loaded after slot was claimed, is taken as is
+        if (effective.size() < limit)
+            effective.resize(limit, 0);
+
+        epoch_t oldest = current_epoch;
+
+        for (uint32_t block = 0; block < _max_blocks && block_base(block) < limit; block++)
+        {
+            smr_ref* slots = blocks[block].load(std::memory_order_acquire);
+            const uint32_t base = block_base(block);
+            const uint32_t count = std::min(block_size(block), limit - base);
+
+            for (uint32_t ndx = 0; ndx < count; ndx++)
+            {
+                epoch_t ref_epoch = slots[ndx]._ref_epoch.load(std::memory_order_relaxed);
+                epoch_t effective_epoch = effective[base + ndx];
+                if (ref_epoch == 0)
+                    effective_epoch = current_epoch;                        // current epoch
+                else if (ref_epoch > effective_epoch)
+                    effective_epoch = ref_epoch;
+                effective[base + ndx] = effective_epoch;
+
+                if (effective_epoch < oldest)
+                    oldest = effective_epoch;
+            }
+        }
+
+        return oldest;
+    }
+
+    /**
+     * slot's effective epoch as of last scan()
+     */
+    epoch_t effective_epoch(const smr_ref* ref) const
+    {
+        return ref->_index < effective.size() ? effective[ref->_index] : 0;
+    }
+};
+
+
+/**
+ * Scanner threads, one per NUMA node and bound to the node's cpus,
+ * each scanning its node's reader slots of a registry on request and
+ * publishing the node's oldest epoch.  Owned by a domain's registry,
+ * or shared by the domains of an smr_reclaimer, one scan at a time.
+ *
+ * Nodes are the online nodes w/ cpus, indexed in sysfs order.  W/
+ * simulated nodes, for testing, scanners aren't bound and threads
+ * are assigned to nodes by thread id.
+ */
+class smr_numa_scanners
+{
+    struct alignas(64) scanner
+    {
+        std::thread thread;
+        std::atomic<epoch_t> oldest{0};     // node's oldest epoch, last scan
+    };
+
+    std::vector<uint32_t> node_ids;                     // sysfs node id by node index, empty if simulated
+    std::vector<uint16_t> node_index;                   // node index by sysfs node id
+    std::vector<std::unique_ptr<scanner>> scanners;     // by node index
+
+    std::mutex mutex;                                   // serializes scan()
+    std::vector<std::unique_ptr<smr_slots>>* scan_slots = nullptr;  // requested scan's slots by node
+    std::atomic<epoch_t> scan_epoch{0};                 // requested scan's current epoch
+    std::atomic_bool scanning{true};
+    alignas(64) std::atomic<uint32_t> scan_seq = 0;     // futex word, bumped per scan request
+    alignas(64) std::atomic<uint32_t> scan_done = 0;    // futex word, node scans completed
+
+    void run(uint32_t node)
+    {
+        if (!node_ids.empty())
+            smr_numa::bind(node_ids[node]);
+
+        uint32_t seq = 0;
+        for (;;)
+        {
+            uint32_t _seq;
+            while ((_seq = scan_seq.load(std::memory_order_acquire)) == seq)
+                futex::wait(&scan_seq, seq, std::chrono::nanoseconds(-1));
+            seq = _seq;
+            if (!scanning.load(std::memory_order_relaxed))
+                break;
+
+            // ordered after reclaim's memory barrier by scan_seq
+            scanners[node]->oldest.store((*scan_slots)[node]->scan(scan_epoch.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+            scan_done.fetch_add(1, std::memory_order_release);
+            futex::wake(&scan_done, 1);
+        }
+    }
+
+public:
+
+    const uint32_t simulated;               // simulated node count, 0 = system topology
+
+    /**
+     * @param simulated number of nodes to simulate, 0 = system topology
+     */
+    smr_numa_scanners(uint32_t simulated = 0) : simulated(simulated)
+    {
+        uint32_t count = simulated;
+        if (simulated == 0)
+        {
+            node_ids = smr_numa::nodes();
+            for (uint32_t ndx = 0; ndx < node_ids.size(); ndx++)
+            {
+                if (node_index.size() <= node_ids[ndx])
+                    node_index.resize(node_ids[ndx] + 1, 0);
+                node_index[node_ids[ndx]] = ndx;
+            }
+            count = node_ids.size();
+        }
+
+        if (count < 2)
+            return;
+        for (uint32_t node = 0; node < count; node++)
+            scanners.push_back(std::make_unique<scanner>());
+        for (uint32_t node = 0; node < count; node++)
+            scanners[node]->thread = std::thread([this, node] () { this->run(node); });
+    }
+
+    ~smr_numa_scanners()
+    {
+        scanning.store(false, std::memory_order_relaxed);
+        scan_seq.fetch_add(1, std::memory_order_release);
+        futex::wake(&scan_seq, INT32_MAX);
+        for (auto& scanner : scanners)
+            scanner->thread.join();
+    }
+
+    /**
+     * @return scanners, nullptr if fewer than 2 nodes
+     */
+    static std::shared_ptr<smr_numa_scanners> create(uint32_t simulated = 0)
+    {
+        auto scanners = std::make_shared<smr_numa_scanners>(simulated);
+        return scanners->nodes() > 1 ? scanners : nullptr;
+    }
+
+    uint32_t nodes() const { return scanners.size(); }
+
+    /**
+     * @return node index of cpu calling thread is running on, 0 for
+     * nodes not in use
+     */
+    uint32_t current_node() const
+    {
+        if (simulated != 0)
+            return smr_gettid() % simulated;
+        uint32_t node = smr_numa::current_node();
+        return node < node_index.size() ? node_index[node] : 0;
+    }
+
+    /**
+     * scan each node's slots on its scanner, see smr_slots::scan()
+     * @param slots registry's slots by node index
+     * @return oldest referenced epoch
+     */
+    epoch_t scan(std::vector<std::unique_ptr<smr_slots>>& slots, const epoch_t current_epoch)
+    {
+        std::scoped_lock m(mutex);
+        scan_slots = &slots;
+        scan_epoch.store(current_epoch, std::memory_order_relaxed);
+        scan_done.store(0, std::memory_order_relaxed);
+        scan_seq.fetch_add(1, std::memory_order_seq_cst);
+        futex::wake(&scan_seq, INT32_MAX);
+
+        uint32_t done;
+        while ((done = scan_done.load(std::memory_order_acquire)) < scanners.size())
+            futex::wait(&scan_done, done, std::chrono::nanoseconds(-1));
+
+        epoch_t oldest = current_epoch;
+        for (auto& scanner : scanners)
+        {
+            epoch_t _oldest = scanner->oldest.load(std::memory_order_relaxed);
+            if (_oldest < oldest)
+                oldest = _oldest;
+        }
+        return oldest;
+    }
+};
+
+
+/**
+ * Reader slot registry, slots grouped by NUMA node.
+ *
+ * W/ numa scanners, a thread claims slots from the slots of the node
+ * it is running on, and each node's slots are scanned by the node's
+ * scanner thread, see smr_numa_scanners.  The reclaim thread then
+ * only touches a few lines per node rather than every reader slot.
+ * W/o, scan() scans the slots directly.
+ */
+class smr_registry
+{
+    smr_wakeup _wakeup;
+
+public:
+    smr_wakeup& wakeup;                     // domain reclaim wake up, own or reclaim service's
+
+    /**
+     * epoch readers lock, read-mostly, stored by scan() only when it
+     * changes.  Own line so reclaim's other updates don't invalidate it.
+     */
+    alignas(64) std::atomic<epoch_t> epoch{1};
+
+    alignas(64) std::atomic<epoch_t> hint_epoch{0};     // oldest epoch blocking reclaim, 0 = none
+
+    smr_hold_histogram hold_times;          // SMRPROXY_PROFILE only
+
+private:
+
+    std::vector<std::unique_ptr<smr_slots>> nodes;      // by node index
+
+    std::shared_ptr<smr_numa_scanners> scanners;        // nullptr = scan on caller
+
+public:
+
+    /**
+     * @param wakeup reclaim service wake up, nullptr for domain's own
+     * @param scanners NUMA scanners to group slots by node and scan
+     * them w/, nullptr = single group scanned by reclaim
+     */
+    smr_registry(smr_wakeup* wakeup = nullptr, std::shared_ptr<smr_numa_scanners> scanners = nullptr)
+        : wakeup(wakeup != nullptr ? *wakeup : _wakeup), scanners(std::move(scanners))
+    {
+        uint32_t count = this->scanners != nullptr ? this->scanners->nodes() : 1;
+        for (uint32_t node = 0; node < count; node++)
+            nodes.push_back(std::make_unique<smr_slots>(&epoch, &this->wakeup, &hint_epoch, &hold_times, node));
+    }
+
+    /**
+     * claim a free reader slot, from the calling thread's node w/ numa
+     */
+    smr_ref* claim()
+    {
+        uint32_t node = scanners != nullptr ? scanners->current_node() : 0;
+        return nodes[node < nodes.size() ? node : 0]->claim();
+    }
+
+    /**
+     * return reader slot to free stack, slot should be unlocked
+     */
+    void release(smr_ref* ref)
+    {
+        nodes[ref->_node]->release(ref);
+    }
+
+    /**
+     * apply fn to every slot up to the high water marks, claimed or not
+     */
+    template<typename F>
+    void for_each(F&& fn)
+    {
+        for (auto& slots : nodes)
+            slots->for_each(fn);
+    }
+
+    /**
+     * publish current epoch to readers, set slot effective epochs and
+     * find oldest referenced epoch, callers serialized
+     * @param current_epoch current domain epoch
+     * @return oldest referenced epoch
+     */
+    epoch_t scan(const epoch_t current_epoch)
+    {
+        if ((uint64_t) epoch.load(std::memory_order_relaxed) != (uint64_t) epoch_t(current_epoch))
+            epoch.store(current_epoch, std::memory_order_release);     // see smr_ref::advance_epoch()
+
+        if (scanners == nullptr)
+            return nodes[0]->scan(current_epoch);
+
+        return scanners->scan(nodes, current_epoch);
+    }
+
+    /**
+     * slot's effective epoch as of last scan()
+     */
+    epoch_t effective_epoch(const smr_ref* ref) const
+    {
+        return nodes[ref->_node]->effective_epoch(ref);
+    }
+
+    /**
+     * registry wide slot id, for reporting
+     */
+    uint32_t slot_id(const smr_ref* ref) const
+    {
+        return ref->_index * nodes.size() + ref->_node;
+    }
+
+    /**
+     * apply fn to every claimed slot
+     */
+    template<typename F>
+    void for_each_claimed(F&& fn)
+    {
+        for_each([&fn] (smr_ref* ref) {
+            if (ref->_claimed.load(std::memory_order_relaxed))
+                fn(ref);
+        });
+    }
+};
+
+
+/**
+ * reader stall watchdog report
+ */
+struct smr_stall
+{
+    uint32_t slot;                          // reader slot index
+    pid_t tid;                              // thread that claimed the slot
+    std::string thread_name;
+    epoch_t epoch;                          // pinned epoch
+    std::chrono::milliseconds duration;     // time pinned so far
+    uint64_t deferred;                      // objects held back in defer queue
+};
+
+
+/**
+ * retire latency class, see smrproxy::retire(smr_obj_base*, smr_latency, size_t)
+ */
+enum class smr_latency
+{
+    normal,         // next reclaim pass, retire_batch
+    urgent,         // expedited reclaim pass, e.g. objects holding scarce resources
+    bulk,           // coalesced locally, bulk_batch
+};
+
+
+/**
+ * smrproxy configuration
+ */
+struct smrproxy_config
+{
+    uint32_t wait_ms = 50;          // reclaim poll interval in milliseconds
+
+    /**
+     * adaptive reclaim scheduling.  Poll interval shrinks from wait_ms
+     * toward min_wait_ms as the deferred backlog exceeds backlog_target
+     * objects.  W/ unlock_hint, it also backs off toward max_wait_ms
+     * while passes make no progress and nothing new is retired, since
+     * the reader pinning reclaim wakes it on unlock.  W/o unlock_hint
+     * there is no backoff, memory would be held up to max_wait_ms
+     * after the reader unlocks.  0 = wait_ms, no backoff.
+     */
+    bool adaptive = true;
+    uint32_t min_wait_ms = 1;
+    uint32_t max_wait_ms = 0;
+    uint32_t backlog_target = 1024;
+
+    /**
+     * readers wake reclaim thread when unlocking the oldest epoch
+     * blocking reclaim
+     */
+    bool unlock_hint = false;
+
+    /**
+     * number of objects a thread collects locally before publishing
+     * them to the retire queue, 1 = publish on every retire.  Batches
+     * older than wait_ms are published by the reclaim thread.
+     */
+    uint32_t retire_batch = 1;
+
+    /**
+     * number of smr_latency::bulk objects a thread collects locally
+     * before publishing them, at least retire_batch
+     */
+    uint32_t bulk_batch = 1024;
+
+    /**
+     * hand expired objects back to the thread that retired them, to be
+     * deleted by that thread on its next retire() or drain().  Objects
+     * of exited threads are deleted by reclaim.  retire_batch is not
+     * used, each thread already retires onto its own list.  In bounded
+     * mode, a writer over the limit deletes objects handed back to
+     * other threads that haven't drained them.
+     */
+    bool return_to_owner = false;
+
+    /**
+     * number of deleter threads, 0 = delete expired objects
+     * on the reclaim thread
+     */
+    uint32_t delete_threads = 0;
+
+    /**
+     * user supplied executor for deleting expired objects,
+     * overrides delete_threads
+     */
+    smr_executor executor;
+
+    /**
+     * maximum number of objects deleted by the reclaim thread
+     * per reclaim pass, 0 = no limit.  Not used with deleter
+     * threads or executor.
+     */
+    uint32_t delete_budget = 0;
+
+    /**
+     * bounded mode, maximum number and total size hint of retired
+     * objects not yet deleted, 0 = unbounded.  Writers exceeding
+     * either limit do reclaim work themselves and then block in
+     * retire() or fail in try_retire().  Writers must not hold a
+     * read lock when retiring in bounded mode.
+     */
+    uint64_t max_retired = 0;
+    uint64_t max_retired_bytes = 0;
+
+    /**
+     * shared reclaim service to use instead of a per domain
+     * reclaim thread
+     */
+    smr_reclaimer* reclaimer = nullptr;
+
+    /**
+     * group reader slots by NUMA node, each node's slots scanned by
+     * a scanner thread on that node.  Scanners are shared by the
+     * domains of a reclaimer service.  Only online nodes w/ cpus are
+     * used, no effect on single node systems.
+     */
+    bool numa_scan = false;
+
+    /**
+     * w/ numa_scan, number of nodes to simulate, threads assigned to
+     * nodes by thread id, for testing.  0 = system topology.
+     */
+    uint32_t numa_nodes = 0;
+
+    /**
+     * reader stall watchdog, reports readers pinning an epoch for
+     * longer than stall_ms while reclaim is pending, 0 = off.  Each
+     * stall is reported once, by stall_handler on the reclaim thread
+     * or to stderr if not set.
+     */
+    uint32_t stall_ms = 0;
+    std::function<void(const smr_stall&)> stall_handler;
+
+    /**
+     * shared memory page the reclaim thread publishes metrics() to
+     * after each pass, nullptr = none.  Must outlive the domain.
+     */
+    smr_stats_page* stats_page = nullptr;
+};
+
+
+/**
+ * bounded mode backpressure counters
+ */
+struct smr_backpressure_stats
+{
+    uint64_t count = 0;         // retires exceeding limits
+    uint64_t blocked = 0;       // retires that waited for space
+    uint64_t failed = 0;        // try_retire failures
+    uint64_t reclaims = 0;      // reclaim passes run by writers
+};
+
+
+/**
+ * Pool of threads deleting lists of expired objects.
+ */
+class smr_deleter_pool
+{
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable cvar;
+    std::deque<std::function<void()>> queue;     // guarded by mutex
+    bool active = true;
+
+    void run()
+    {
+        std::unique_lock m(mutex);
+        for (;;)
+        {
+            cvar.wait(m, [this] () { return !queue.empty() || !active; });
+            if (queue.empty())
+                break;
+
+            std::function<void()> task = std::move(queue.front());
+            queue.pop_front();
+
+            m.unlock();
+            task();
+            m.lock();
+        }
+    }
+
+public:
+
+    smr_deleter_pool(uint32_t nthreads)
+    {
+        for (uint32_t ndx = 0; ndx < nthreads; ndx++)
+            threads.emplace_back([this] () { this->run(); });
+    }
+
+    /**
+     * finishes queued tasks before returning
+     */
+    ~smr_deleter_pool()
+    {
+        {
+            std::scoped_lock m(mutex);
+            active = false;
+        }
+        cvar.notify_all();
+        for (std::thread& thread : threads)
+            thread.join();
+    }
+
+    void submit(std::function<void()> task)
+    {
+        {
+            std::scoped_lock m(mutex);
+            queue.push_back(std::move(task));
+        }
+        cvar.notify_one();
+    }
+};
+
+
+/**
+ * Per thread, per domain state.  Holds the thread's reader slot,
+ * claimed on first use, and its local retire batch.
+ *
+ * Shared by the thread's cache and the domain so either side can
+ * go away first.  The domain pointer is cleared when the domain is
+ * destroyed, mutex serializes that with thread exit.
+ */
+class smr_local
+{
+    friend class smrproxy;
+    friend class smr_local_cache;
+
+    std::shared_ptr<smr_registry> registry;
+    smr_ref* ref = nullptr;
+
+    // local retire batch, taken whole by flush() or by reclaim once aged
+    std::atomic<smr_obj_base*> head = nullptr;
+    smr_obj_base* tail = nullptr;                   // this thread only, reset when batch found taken
+    uint32_t count = 0;
+    std::atomic<uint64_t> head_since = 0;           // first push onto empty batch, smr_clock_ns()
+
+    // pointers retired w/ deleters, not yet published, held by this thread while adding
+    std::atomic<smr_retire_block*> block = nullptr;
+    std::atomic<uint64_t> block_since = 0;          // block created, smr_clock_ns()
+
+    static constexpr size_t task_ref_cache = 16;
+    std::vector<smr_ref*> task_refs;    // free slots for smr_task_ref, released on exit
+
+    // return_to_owner mode
+    std::atomic<smr_obj_base*> retired = nullptr;   // retired by this thread, taken by reclaim
+    std::atomic<uint64_t> retired_count = 0;        // objects pushed onto retired
+    std::atomic<uint64_t> retired_since = 0;        // first push onto empty retired, smr_clock_ns()
+    uint64_t advanced_count = 0;                    // retired_count at last advance, domain mutex
+
+    struct returned_list
+    {
+        smr_obj_base* head;
+        uint64_t count;
+        epoch_t expiry;
+        uint64_t start;                             // for retire to delete latency
+    };
+    std::vector<returned_list> returned;            // expired, to be deleted by this thread, guarded by mutex
+    std::atomic_bool has_returned{false};
+    bool exited = false;                            // guarded by mutex
+    bool exiting = false;                           // exit() using domain w/o mutex, guarded by mutex
+
+    std::mutex mutex;
+    std::condition_variable exit_cvar;  // exiting cleared
+    smrproxy* domain;                   // guarded by mutex
+    std::atomic_bool closed{false};     // domain destroyed
+
+public:
+
+    smr_local(smrproxy* domain, std::shared_ptr<smr_registry> registry)
+        : registry(registry), domain(domain) {}
+
+    /**
+     * on thread exit, publish local batch, delete returned objects,
+     * and release reader slot
+     */
+    void exit();
+
+    /**
+     * hand expired list back to this thread
+     * @return false if thread exited or domain closed
+     */
+    bool give(const returned_list& list)
+    {
+        std::scoped_lock m(mutex);
+        if (exited || domain == nullptr)
+            return false;
+        returned.push_back(list);
+        has_returned.store(true, std::memory_order_release);
+        return true;
+    }
+};
+
+
+/**
+ * Per thread cache of smr_local state, one per domain, keyed by
+ * the domain's registry.  Entries hold a reference to the registry
+ * so the key can't be reused by another domain while cached.
+ */
+class smr_local_cache
+{
+    std::vector<std::shared_ptr<smr_local>> entries;
+
+    smr_registry* last_registry = nullptr;  // last lookup
+    smr_local* last_local = nullptr;
+
+public:
+
+    ~smr_local_cache()
+    {
+        for (auto& local : entries)
+            local->exit();
+        entries.clear();
+    }
+
+    inline smr_local* get(smrproxy* domain, const std::shared_ptr<smr_registry>& registry)
+    {
+        if (registry.get() == last_registry)
+            return last_local;
+
+        return _get(domain, registry);
+    }
+
+private:
+
+    smr_local* _get(smrproxy* domain, const std::shared_ptr<smr_registry>& registry);
+};
+
+inline thread_local smr_local_cache _smr_locals;
+
+
+/**
+ * Reclaim service driving many smrproxy domains from a few threads.
+ *
+ * Each pass covers all of a thread's domains with pending retires
+ * with a single membarrier::sync() and then scans each domain's refs.
+ * Domains are assigned to service threads round robin when created
+ * and must be destroyed before the service.
+ */
+class smr_reclaimer
+{
+    friend class smrproxy;
+
+    struct worker
+    {
+        smr_wakeup wakeup;
+        std::mutex mutex;                   // guards domains, held during pass
+        std::vector<smrproxy*> domains;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<worker>> workers;
+    std::atomic<uint32_t> next = 0;         // round robin
+    std::atomic_bool active{true};
+
+    void run(worker& w);
+
+    worker* assign() { return workers[next.fetch_add(1, std::memory_order_relaxed) % workers.size()].get(); }
+
+    std::mutex numa_mutex;
+    std::shared_ptr<smr_numa_scanners> numa;        // shared by numa_scan domains, guarded by numa_mutex
+
+    void add(worker* w, smrproxy* domain)
+    {
+        std::scoped_lock m(w->mutex);
+        w->domains.push_back(domain);
+    }
+
+    /**
+     * remove domain, waits for any pass in progress
+     */
+    void remove(worker* w, smrproxy* domain)
+    {
+        std::scoped_lock m(w->mutex);
+        std::erase(w->domains, domain);
+    }
+
+public:
+
+    smr_reclaimer(uint32_t nthreads)
+    {
+        membarrier::_register();
+        for (uint32_t ndx = 0; ndx < std::max(nthreads, 1u); ndx++)
+            workers.push_back(std::make_unique<worker>());
+        for (auto& w : workers)
+            w->thread = std::thread([this, w = w.get()] () { this->run(*w); });
+    }
+
+    smr_reclaimer() : smr_reclaimer(1) {}
+
+    ~smr_reclaimer()
+    {
+        active.store(false);
+        for (auto& w : workers)
+        {
+            w->wakeup.wake_all();
+            w->thread.join();
+        }
+    }
+
+    /**
+     * NUMA scanners shared by domains, see smrproxy_config::numa_scan
+     * @param simulated simulated node count, 0 = system topology
+     * @return scanners, nullptr if fewer than 2 nodes
+     */
+    std::shared_ptr<smr_numa_scanners> numa_scanners(uint32_t simulated)
+    {
+        std::scoped_lock m(numa_mutex);
+        if (numa == nullptr || numa->simulated != simulated)
+            numa = smr_numa_scanners::create(simulated);
+        return numa;
+    }
+};
+
+
+/**
+ * Awaitable grace period, see smrproxy::grace_period().  Lives in the
+ * awaiting coroutine's frame and is linked onto the domain's awaiter
+ * list while suspended.
+ */
+class smr_grace_period
+{
+    friend class smrproxy;
+
+    smrproxy* const domain;
+    const epoch_t cookie;
+    smr_executor executor;
+    std::coroutine_handle<> handle;
+    smr_grace_period* next = nullptr;
+
+public:
+
+    smr_grace_period(smrproxy* domain, epoch_t cookie, smr_executor executor)
+        : domain(domain), cookie(cookie), executor(std::move(executor)) {}
+
+    bool await_ready();
+    void await_suspend(std::coroutine_handle<> handle);
+    void await_resume() {}
+};
+
+
+/**
+ * objects released by smrproxy::retire_subtree() from the destructors
+ * of objects a domain is deleting on this thread, and frees batched
+ * until the delete pass ends, see smr_slab::free()
+ */
+struct smr_subtree
+{
+    const smrproxy* domain;
+    smr_obj_base* head = nullptr;
+    void (*flush_frees)() = nullptr;        // set by a batched free
+};
+
+inline thread_local smr_subtree* _smr_subtree = nullptr;
+
+
+class smrproxy
+{
+    friend class smr_local;
+    friend class smr_grace_period;
+    friend class smr_task_ref;
+    friend class smr_reclaimer;
+    friend class smr_local_cache;
+
+    epoch_t domain_epoch = 1;
+    epoch_t synced_epoch = 1;               // last epoch w/ memory barrier after advance
+
+    smr_reclaimer* const service;           // reclaim service or nullptr
+    smr_reclaimer::worker* const worker;
+
+    std::shared_ptr<smr_registry> refs;     // reader slots
+
+    std::thread reclaim_task;
+
+    std::mutex mutex;
+    smr_wakeup& wakeup = refs->wakeup;
+    std::chrono::milliseconds wait_ms;
+
+    const bool adaptive;
+    const std::chrono::milliseconds min_wait_ms;
+    const std::chrono::milliseconds max_wait_ms;
+    const uint32_t backlog_target;
+    const bool unlock_hint;
+
+    uint64_t deferred_count = 0;                    // objects in defer_queue
+    uint64_t advanced_count = 0;                    // tail_count at last advance
+    uint32_t backoff = 0;                           // poll interval backoff shift
+    bool locals_pending = false;                    // local batches or blocks not yet aged, see take_aged()
+
+    const uint32_t retire_batch;
+    const uint32_t bulk_batch;
+    const bool return_to_owner;
+
+    const uint32_t delete_budget;
+    smr_executor executor;
+    std::unique_ptr<smr_deleter_pool> deleters;
+    std::atomic<uint32_t> executor_pending = 0;     // lists submitted to executor, not yet deleted
+
+    /**
+     * header for list of objects retired in the same reclaim pass.
+     * Expiry is kept here rather than in each object so a pass
+     * doesn't touch retired objects until they are deleted.
+     */
+    struct smr_batch
+    {
+        smr_obj_base* head;
+        uint64_t count;
+        epoch_t expiry;
+        std::shared_ptr<smr_local> owner = nullptr;     // return_to_owner mode
+        uint64_t start = 0;                             // first retire, smr_clock_ns(), 0 = unknown
+    };
+
+    std::deque<smr_batch> delete_queue;             // expired, not yet deleted -- reclaim thread only
+
+    const uint64_t max_retired;
+    const uint64_t max_retired_bytes;
+    const bool bounded;
+    std::atomic<uint64_t> outstanding_count = 0;    // retired objects not yet deleted, bounded mode only
+    std::atomic<uint64_t> outstanding_bytes = 0;
+    std::atomic<uint32_t> space_seq = 0;            // futex word, bumped on deletes in bounded mode
+    std::atomic<uint32_t> space_waiters = 0;        // writers waiting on space_seq
+
+    struct {
+        std::atomic<uint64_t> count = 0;
+        std::atomic<uint64_t> blocked = 0;
+        std::atomic<uint64_t> failed = 0;
+        std::atomic<uint64_t> reclaims = 0;
+    } backpressure;
+
+    std::atomic_bool active{true};             //
+
+    alignas(64) std::atomic<smr_obj_base *> tail = nullptr;     // retire queue
+    std::atomic<uint64_t> tail_count = 0;           // objects pushed onto tail, same cache line
+    std::atomic<uint64_t> tail_since = 0;           // first push onto empty tail, smr_clock_ns()
+    std::atomic_bool urgent{false};                 // urgent retire since last advance
+
+    epoch_t urgent_expiry = 0;                      // latest batch w/ urgent retires, 0 = none, mutex
+
+    /**
+     * batch headers in advance order, expiry is monotonic so
+     * batches expire in fifo order from the front
+     */
+    alignas(64) std::deque<smr_batch> defer_queue;
+
+    // grace period state
+    std::atomic<epoch_t> requested_epoch{0};        // latest get_state() cookie
+    std::atomic<epoch_t> completed_epoch{0};        // min(oldest, synced_epoch) at last scan
+    std::atomic<uint32_t> gp_seq = 0;               // futex word, bumped when completed_epoch advances
+    std::atomic<uint32_t> gp_waiters = 0;
+    std::atomic<smr_grace_period*> gp_awaiters = nullptr;   // suspended coroutines
+
+    // reader stall watchdog, reclaim only
+    const std::chrono::milliseconds stall_ms;
+    std::function<void(const smr_stall&)> stall_handler;
+    struct stall_state
+    {
+        epoch_t epoch;                              // pinned epoch, 0 = none
+        std::chrono::steady_clock::time_point since;
+        bool reported;
+    };
+    std::vector<stall_state> stalls;                // by slot index
+
+    smr_stats_page* const stats_page;
+
+    /**
+     * metrics counters, relaxed, read w/o mutex by metrics().  Delete
+     * counters are updated by whichever thread deletes.
+     */
+    alignas(64) struct {
+        std::atomic<uint64_t> retired = 0;
+        std::atomic<uint64_t> deleted = 0;
+        std::atomic<uint64_t> defer_batches = 0;
+        std::atomic<uint64_t> deferred = 0;
+        std::atomic<uint64_t> epoch_lag = 0;
+        std::atomic<uint64_t> passes = 0;
+        std::atomic<uint64_t> scan_ns = 0;
+        std::atomic<uint64_t> sync_ns = 0;
+        std::atomic<uint64_t> delete_ns = 0;
+        std::atomic<uint64_t> latency[smr_metrics::latency_buckets] = {};
+    } stats;
+
+    std::mutex locals_mutex;
+    std::vector<std::shared_ptr<smr_local>> locals;     // thread local states, guarded by locals_mutex
+
+    /**
+     * NUMA scanners for config, the reclaim service's if any
+     */
+    static std::shared_ptr<smr_numa_scanners> numa_scanners(const smrproxy_config& config)
+    {
+        if (!config.numa_scan)
+            return nullptr;
+        if (config.reclaimer != nullptr)
+            return config.reclaimer->numa_scanners(config.numa_nodes);
+        return smr_numa_scanners::create(config.numa_nodes);
+    }
+
+public:
+
+    smrproxy(const smrproxy_config& config)
+        : service(config.reclaimer),
+          worker(config.reclaimer != nullptr ? config.reclaimer->assign() : nullptr),
+          refs(std::make_shared<smr_registry>(worker != nullptr ? &worker->wakeup : nullptr, numa_scanners(config))),
+          adaptive(config.adaptive),
+          min_wait_ms(std::min(config.min_wait_ms, config.wait_ms)),
+          max_wait_ms(config.unlock_hint ? std::max(config.max_wait_ms, config.wait_ms) : config.wait_ms),
+          backlog_target(std::max(config.backlog_target, 1u)),
+          unlock_hint(config.unlock_hint),
+          retire_batch(std::max(config.retire_batch, 1u)),
+          bulk_batch(std::max(config.bulk_batch, retire_batch)),
+          return_to_owner(config.return_to_owner),
+          delete_budget(config.delete_budget),
+          executor(config.executor),
+          max_retired(config.max_retired),
+          max_retired_bytes(config.max_retired_bytes),
+          bounded(config.max_retired != 0 || config.max_retired_bytes != 0),
+          stall_ms(config.stall_ms),
+          stall_handler(config.stall_handler),
+          stats_page(config.stats_page)
+    {
+        this->wait_ms = std::chrono::milliseconds(config.wait_ms);
+        if (!executor && config.delete_threads > 0)
+            deleters = std::make_unique<smr_deleter_pool>(config.delete_threads);
+        if (service != nullptr)
+        {
+            service->add(worker, this);
+        }
+        else
+        {
+            membarrier::_register();
+            reclaim_task = std::thread([this] () { this->reclaim(); });
+        }
+    }
+
+    smrproxy(uint32_t wait_ms) : smrproxy(smrproxy_config{.wait_ms = wait_ms}) {}
+
+    smrproxy() : smrproxy(smrproxy_config{}) {}
+
+    ~smrproxy()
+    {
+        active.store(false);
+        if (service != nullptr)
+        {
+            service->remove(worker, this);
+        }
+        else
+        {
+            wakeup.wake_all();
+            reclaim_task.join();
+        }
+        delete_expired(0);
+        deleters.reset();                   // finish pending deletes
+        for (uint32_t n; (n = executor_pending.load()) != 0;)
+            executor_pending.wait(n);
+
+        refs->for_each_claimed([] (smr_ref* ref) { ref->print(); });
+        close_locals();
+        try_reclaim();              // _try_reclaim?
+        resume_awaiters(true);      // no readers left
+
+        smr_obj_base* _tail = tail.exchange(nullptr);
+        if (_tail != nullptr)
+        {
+            fprintf(stderr, "return queue not null\n");
+            delete_objects(_tail, domain_epoch);
+        }
+        if (!defer_queue.empty()) {
+            fprintf(stderr, "defer queue size = %d\n", defer_queue.size());
+            std::for_each(defer_queue.begin(), defer_queue.end(), [this] (smr_batch& batch)
+            {
+                delete_objects(batch.head, batch.expiry);
+            });
+            defer_queue.clear();
+        }
+
+    }
+
+    smr_ref* acquire_ref() {
+        return refs->claim();
+    }
+
+    void release_ref(smr_ref* ref) {
+        refs->release(ref);
+    }
+
+    /**
+     * Thread local shared lock reference.  Acquired on first use
+     * by the calling thread and released when the thread exits.
+     * Do not pass to release_ref().
+     */
+    inline smr_ref* local_ref() {
+        smr_local* local = _smr_locals.get(this, refs);
+        if (local->ref == nullptr)
+            local->ref = acquire_ref();
+        return local->ref;
+    }
+
+private:
+
+    /**
+     * slot for smr_task_ref lock, from calling thread's cache of
+     * free slots if possible
+     */
+    smr_ref* claim_task_ref() {
+        smr_local* local = _smr_locals.get(this, refs);
+        if (local->task_refs.empty())
+            return refs->claim();
+
+        smr_ref* ref = local->task_refs.back();
+        local->task_refs.pop_back();
+        ref->_owner_tid.store(smr_gettid(), std::memory_order_relaxed);
+        ref->_claimed.store(true, std::memory_order_relaxed);
+        return ref;
+    }
+
+    /**
+     * return unlocked smr_task_ref slot to calling thread's cache
+     */
+    void release_task_ref(smr_ref* ref) {
+        smr_local* local = _smr_locals.get(this, refs);
+        if (local->task_refs.size() < smr_local::task_ref_cache)
+        {
+            ref->_claimed.store(false, std::memory_order_relaxed);     // cached, not in use
+            local->task_refs.push_back(ref);
+        }
+        else
+            refs->release(ref);
+    }
+
+public:
+
+    /**
+     * read lock using the thread local shared lock reference,
+     * e.g. std::scoped_lock m(proxy);
+     */
+    inline void lock() { local_ref()->lock(); }
+    inline void unlock() { local_ref()->unlock(); }
+
+    void retire(smr_obj_base * data) {
+        retire(data, 0);
+    }
+
+    /**
+     * @param size size hint for bounded mode
+     */
+    void retire(smr_obj_base * data, size_t size) {
+        if (data == nullptr)
+            return;
+
+        if (bounded)
+            reserve(data, 1, size, true);
+
+        _retire(data);
+    }
+
+    /**
+     * Retire object w/ latency class.  An urgent retire is published
+     * at once and wakes the reclaim thread for an immediate pass w/ a
+     * memory barrier.  Until it expires, reclaim polls at min_wait_ms
+     * and readers unlocking the epoch holding it back wake reclaim.
+     * Bulk retires are collected locally, bulk_batch at a time, to
+     * minimize retire queue updates, or until reclaim publishes the
+     * batch after wait_ms.  In return_to_owner mode bulk is
+     * the same as normal, urgent objects are deleted by reclaim.
+     * @param size size hint for bounded mode
+     */
+    void retire(smr_obj_base * data, smr_latency latency, size_t size = 0) {
+        if (data == nullptr)
+            return;
+
+        if (bounded)
+            reserve(data, 1, size, true);
+
+        _retire(data, latency);
+    }
+
+    /**
+     * Retire object unless bounded mode limits are exceeded after
+     * doing reclaim work.
+     * @param size size hint for bounded mode
+     * @return false if object was not retired
+     */
+    bool try_retire(smr_obj_base * data, size_t size = 0) {
+        if (data == nullptr)
+            return true;
+
+        if (bounded && !reserve(data, 1, size, false))
+            return false;
+
+        _retire(data);
+        return true;
+    }
+
+    /**
+     * Retire an object only reachable through an object this domain is
+     * deleting, e.g. the children of a tree node, retired from the
+     * node's destructor.  Called from such a destructor, the object is
+     * deleted in the same reclaim pass as its parent rather than after
+     * another grace period.  Otherwise it is retired as by retire().
+     * Objects still reachable by readers some other way, e.g. unlinked
+     * from a shared list in the destructor, must use retire().
+     */
+    void retire_subtree(smr_obj_base * data) {
+        if (data == nullptr)
+            return;
+
+        if (_smr_subtree != nullptr && _smr_subtree->domain == this)
+        {
+            data->smr_obj_next = _smr_subtree->head;
+            _smr_subtree->head = data;
+            return;
+        }
 
-    void reclaim()
+        retire(data);
+    }
+
+    /**
+     * Retire an object not derived from smr_obj_base, deleted
+     * w/ delete once expired.  See retire(void*, deleter_t, size_t).
+     */
+    template<typename T>
+        requires (!std::is_void_v<T> && !std::is_base_of_v<smr_obj_base, T>)
+    void retire(T* ptr) {
+        retire((void*) ptr, [] (void* p) { delete static_cast<T*>(p); }, sizeof(T));
+    }
+
+    /**
+     * Retire an arbitrary pointer w/ deleter.  Pointers are collected
+     * in a thread local smr_retire_block, published as a single retired
+     * object when full, on flush(), or on thread exit.  A partial block
+     * older than wait_ms is published by the reclaim thread.  In bounded
+     * mode a block counts as one object against max_retired.
+     * @param size size hint for bounded mode
+     */
+    void retire(void* ptr, smr_retire_block::deleter_t deleter, size_t size = 0) {
+        if (ptr == nullptr)
+            return;
+
+        smr_local* local = _smr_locals.get(this, refs);
+        smr_retire_block* block = local->block.exchange(nullptr, std::memory_order_acquire);   // reclaim can't take it while adding
+        bool created = block == nullptr;
+        if (created)
+        {
+            stamp_since(local->block_since);
+            block = new smr_retire_block();
+        }
+        block->add(ptr, deleter, size);
+        if (block->full())
+        {
+            publish_block(local, block);
+            return;
+        }
+        local->block.store(block, std::memory_order_seq_cst);
+
+        // wake idle reclaim thread to publish block once aged, see sleep()
+        if (created && wakeup.state.load(std::memory_order_seq_cst) == smr_wakeup::idle)
+            wakeup.wake();
+    }
+
+    /**
+     * sampled reader lock hold times, SMRPROXY_PROFILE only
+     */
+    const smr_hold_histogram& hold_times() {
+        return refs->hold_times;
+    }
+
+    smr_backpressure_stats backpressure_stats() {
+        return {
+            backpressure.count.load(std::memory_order_relaxed),
+            backpressure.blocked.load(std::memory_order_relaxed),
+            backpressure.failed.load(std::memory_order_relaxed),
+            backpressure.reclaims.load(std::memory_order_relaxed),
+        };
+    }
+
+    /**
+     * reclaim pipeline metrics, lock-free, see smr_metrics
+     */
+    smr_metrics metrics() {
+        smr_metrics metrics = {};
+        metrics.timestamp_ns = smr_clock_ns();
+        metrics.epoch = std::atomic_ref(domain_epoch).load(std::memory_order_relaxed);
+        metrics.epoch_lag = stats.epoch_lag.load(std::memory_order_relaxed);
+        metrics.retired = stats.retired.load(std::memory_order_relaxed);
+        metrics.deleted = stats.deleted.load(std::memory_order_relaxed);
+        metrics.outstanding = metrics.retired > metrics.deleted ? metrics.retired - metrics.deleted : 0;
+        metrics.outstanding_bytes = outstanding_bytes.load(std::memory_order_relaxed);
+        metrics.defer_batches = stats.defer_batches.load(std::memory_order_relaxed);
+        metrics.deferred = stats.deferred.load(std::memory_order_relaxed);
+        metrics.passes = stats.passes.load(std::memory_order_relaxed);
+        metrics.scan_ns = stats.scan_ns.load(std::memory_order_relaxed);
+        metrics.sync_ns = stats.sync_ns.load(std::memory_order_relaxed);
+        metrics.delete_ns = stats.delete_ns.load(std::memory_order_relaxed);
+        for (uint32_t ndx = 0; ndx < smr_metrics::latency_buckets; ndx++)
+            metrics.latency[ndx] = stats.latency[ndx].load(std::memory_order_relaxed);
+        return metrics;
+    }
+
+private:
+
+    /**
+     * @param local calling thread's state if known, e.g. on thread exit
+     * where the thread local cache must not be used
+     */
+    void _retire(smr_obj_base * data, smr_latency latency = smr_latency::normal, smr_local* local = nullptr) {
+        epoch_t pre_expiry = std::atomic_ref(domain_epoch).load(std::memory_order_relaxed);   // TODO not actually atomic
+        data->pre_expiry.store(pre_expiry, std::memory_order_relaxed);
+        PROXY_PROBE(smrproxy, retire, data, (uint64_t) pre_expiry);
+
+        if (latency == smr_latency::urgent)
+        {
+            push_list(data, data, 1);
+            urgent.store(true, std::memory_order_seq_cst);     // after push, see _advance()
+            wakeup.wake_all();                                  // even if mid pass
+            return;
+        }
+
+        if (return_to_owner)
+        {
+            if (local == nullptr)
+                local = _smr_locals.get(this, refs);
+            if (local->has_returned.load(std::memory_order_relaxed))
+                drain(local);
+            push_owned(local, data);
+            return;
+        }
+
+        const uint32_t batch = latency == smr_latency::bulk ? bulk_batch : retire_batch;
+        if (batch == 1)
+        {
+            push_list(data, data, 1);
+            return;
+        }
+
+        if (local == nullptr)
+            local = _smr_locals.get(this, refs);
+        push_local(local, data, batch);
+    }
+
+    bool over_limit(uint64_t count, uint64_t size) {
+        return (max_retired != 0 && outstanding_count.load(std::memory_order_relaxed) + count > max_retired)
+            || (max_retired_bytes != 0 && outstanding_bytes.load(std::memory_order_relaxed) + size > max_retired_bytes);
+    }
+
+    /**
+     * account for retired objects in bounded mode, applying
+     * backpressure if limits exceeded
+     * @param obj single object being retired, nullptr for lists
+     * @param block wait for space, otherwise fail
+     * @param local calling thread's state if known, see _retire()
+     * @return false if limits still exceeded and not blocking
+     */
+    bool reserve(smr_obj_base* obj, uint64_t count, uint64_t size, bool block, smr_local* local = nullptr) {
+        if (over_limit(count, size))
+        {
+            backpressure.count.fetch_add(1, std::memory_order_relaxed);
+
+            if (local == nullptr)
+                local = _smr_locals.get(this, refs);
+            flush(local);                           // own retires can be reclaimed
+            bool waited = false;
+            for (;;)
+            {
+                uint32_t seq = space_seq.load(std::memory_order_acquire);
+
+                backpressure.reclaims.fetch_add(1, std::memory_order_relaxed);
+                try_reclaim();
+                if (return_to_owner)
+                {
+                    drain(local);                   // own expired objects
+                    if (over_limit(count, size))
+                        drain_all();                // of owners not retiring
+                }
+                if (!over_limit(count, size))
+                    break;
+
+                if (!block)
+                {
+                    backpressure.failed.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+
+                if (!waited)
+                    backpressure.blocked.fetch_add(1, std::memory_order_relaxed);
+                waited = true;
+
+                wakeup.wake();
+                space_waiters.fetch_add(1, std::memory_order_seq_cst);
+                futex::wait(&space_seq, seq, wait_ms);
+                space_waiters.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+
+        if (obj != nullptr)
+            obj->smr_obj_size = (uint32_t) std::min<uint64_t>(size, UINT32_MAX);
+        outstanding_count.fetch_add(count, std::memory_order_relaxed);
+        outstanding_bytes.fetch_add(size, std::memory_order_relaxed);
+        return true;
+    }
+
+public:
+
+    /**
+     * Retire a linked list of objects with a single update of the
+     * retire queue.
+     * @param head first object
+     * @param tail last object, linked from head by smr_obj_next
+     * @param count number of objects in list, checked against
+     * the list, which is counted while it is stamped
+     * @throws std::invalid_argument if tail isn't reached from head
+     * or count doesn't match, nothing is retired
+     */
+    void retire_list(smr_obj_base* head, smr_obj_base* tail, uint32_t count) {
+        if (head == nullptr)
+            return;
+
+        uint64_t n = 1;
+        epoch_t pre_expiry = std::atomic_ref(domain_epoch).load(std::memory_order_relaxed);
+        smr_obj_base* obj = head;
+        for (; obj != tail && obj != nullptr; obj = obj->smr_obj_next, n++)
+            obj->pre_expiry.store(pre_expiry, std::memory_order_relaxed);
+
+        if (obj == nullptr || n != count)
+        {
+            for (obj = head; obj != nullptr && obj != tail; obj = obj->smr_obj_next)
+                obj->pre_expiry.store(0, std::memory_order_relaxed);
+            throw std::invalid_argument(obj == nullptr ? "retire_list: tail not in list" : "retire_list: count mismatch");
+        }
+        tail->pre_expiry.store(pre_expiry, std::memory_order_relaxed);
+
+        if (bounded)
+            reserve(nullptr, n, 0, true);
+
+        push_list(head, tail, n);
+    }
+
+    /**
+     * publish calling thread's local retire batch and retire block
+     */
+    void flush() {
+        flush(_smr_locals.get(this, refs));
+    }
+
+    /**
+     * delete expired objects handed back to the calling thread,
+     * return_to_owner mode
+     */
+    void drain() {
+        drain(_smr_locals.get(this, refs));
+    }
+
+private:
+
+    /**
+     * push linked list onto retire queue
+     * @param count number of objects in list, counted here so
+     * _advance() doesn't have to walk the list
+     */
+    void push_list(smr_obj_base* head, smr_obj_base* tail, uint64_t count) {
+        smr_obj_base* next = this->tail.load(std::memory_order_relaxed);
+        if (next == nullptr)
+            stamp_since(tail_since);
+        do {
+            tail->smr_obj_next = next;
+        } while (!this->tail.compare_exchange_weak(next, head, std::memory_order_seq_cst));
+        tail_count.fetch_add(count, std::memory_order_relaxed);     // line already owned from cas
+
+        // wake idle reclaim thread, see sleep()
+        if (next == nullptr && wakeup.state.load(std::memory_order_seq_cst) == smr_wakeup::idle)
+            wakeup.wake();
+    }
+
+    /**
+     * stamp first retire time of a list about to be pushed onto while
+     * empty, before the push so reclaim can't take the list first.
+     * Only the first stamp since reclaim took the last one is kept,
+     * reclaim clears it before taking the list, so a stamp is never
+     * later than the first retire of the list it is taken with.
+     */
+    static void stamp_since(std::atomic<uint64_t>& since) {
+        uint64_t zero = 0;
+        since.compare_exchange_strong(zero, smr_clock_ns(), std::memory_order_relaxed);
+    }
+
+    /**
+     * push object onto thread's own retire list, return_to_owner mode
+     */
+    void push_owned(smr_local* local, smr_obj_base* data) {
+        smr_obj_base* next = local->retired.load(std::memory_order_relaxed);
+        if (next == nullptr)
+            stamp_since(local->retired_since);
+        do {
+            data->smr_obj_next = next;
+        } while (!local->retired.compare_exchange_weak(next, data, std::memory_order_seq_cst));
+        local->retired_count.store(local->retired_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+        // wake idle reclaim thread, see sleep()
+        if (next == nullptr && wakeup.state.load(std::memory_order_seq_cst) == smr_wakeup::idle)
+            wakeup.wake();
+    }
+
+    /**
+     * push object onto thread's local batch, published by the thread
+     * when batch objects are collected, or by reclaim once aged
+     */
+    void push_local(smr_local* local, smr_obj_base* data, uint32_t batch) {
+        smr_obj_base* next = local->head.load(std::memory_order_relaxed);
+        if (next == nullptr)
+            stamp_since(local->head_since);
+        do {
+            data->smr_obj_next = next;
+        } while (!local->head.compare_exchange_weak(next, data, std::memory_order_seq_cst));
+
+        if (next == nullptr)                // empty or taken by reclaim
+        {
+            local->tail = data;
+            local->count = 0;
+
+            // wake idle reclaim thread to publish batch once aged, see sleep()
+            if (wakeup.state.load(std::memory_order_seq_cst) == smr_wakeup::idle)
+                wakeup.wake();
+        }
+        if (++local->count >= batch)
+            flush(local);
+    }
+
+    /**
+     * move list taken from another thread to retire queue, counting
+     * it since the count is the other thread's
+     */
+    void take_list(std::atomic<smr_obj_base*>& list) {
+        smr_obj_base* head = list.exchange(nullptr, std::memory_order_acquire);
+        if (head == nullptr)
+            return;
+
+        smr_obj_base* last = head;
+        uint64_t count = 1;
+        for (; last->smr_obj_next != nullptr; last = last->smr_obj_next)
+            count++;
+        push_list(head, last, count);
+    }
+
+    /**
+     * move thread's own retire list to retire queue, deleted by
+     * reclaim w/o returning to thread
+     */
+    void abandon(smr_local* local) {
+        take_list(local->retired);
+    }
+
+    /**
+     * publish thread's local batch from another thread, reclaim or
+     * domain destruction
+     */
+    void take_batch(smr_local* local) {
+        local->head_since.store(0, std::memory_order_relaxed);     // before list, see stamp_since()
+        take_list(local->head);
+    }
+
+    /**
+     * publish thread's partial retire block from another thread, w/o
+     * backpressure, see close_locals()
+     */
+    void take_block(smr_local* local) {
+        local->block_since.store(0, std::memory_order_relaxed);    // before block, see stamp_since()
+        smr_retire_block* block = local->block.exchange(nullptr, std::memory_order_acquire);
+        if (block == nullptr)
+            return;                         // none, or thread adding to it
+
+        block->pre_expiry.store(std::atomic_ref(domain_epoch).load(std::memory_order_relaxed), std::memory_order_relaxed);
+        if (bounded)
+            outstanding_count.fetch_add(1, std::memory_order_relaxed);
+        push_list(block, block, 1);
+    }
+
+    void drain(smr_local* local) {
+        if (!local->has_returned.load(std::memory_order_acquire))
+            return;
+
+        std::vector<smr_local::returned_list> returned;
+        {
+            std::scoped_lock m(local->mutex);
+            returned.swap(local->returned);
+            local->has_returned.store(false, std::memory_order_relaxed);
+        }
+        for (auto& list : returned)
+            delete_batch(list.head, list.count, list.expiry, list.start);
+    }
+
+    /**
+     * delete expired objects handed back to any thread, in bounded
+     * mode when owners that stopped retiring hold back space
+     */
+    void drain_all() {
+        std::vector<std::shared_ptr<smr_local>> _locals;
+        {
+            std::scoped_lock m(locals_mutex);
+            _locals = locals;
+        }
+        for (auto& local : _locals)
+            drain(local.get());
+    }
+
+    void publish_block(smr_local* local, smr_retire_block* block) {
+        local->block_since.store(0, std::memory_order_relaxed);
+
+        if (bounded)
+            reserve(block, 1, sizeof(smr_retire_block) + block->bytes, true, local);
+
+        _retire(block, smr_latency::normal, local);
+    }
+
+    void flush(smr_local* local) {
+        smr_retire_block* block = local->block.exchange(nullptr, std::memory_order_acquire);
+        if (block != nullptr)
+            publish_block(local, block);
+
+        if (local->head.load(std::memory_order_relaxed) == nullptr)
+            return;
+
+        local->head_since.store(0, std::memory_order_relaxed);     // before list, see stamp_since()
+        smr_obj_base* head = local->head.exchange(nullptr, std::memory_order_acquire);
+        if (head != nullptr)                // else taken by reclaim
+            push_list(head, local->tail, local->count);
+        local->count = 0;
+    }
+
+    std::shared_ptr<smr_local> new_local() {
+        auto local = std::make_shared<smr_local>(this, refs);
+        std::scoped_lock m(locals_mutex);
+        std::erase_if(locals, [] (auto& local) { return local.use_count() == 1; });    // exited threads
+        locals.push_back(local);
+        return local;
+    }
+
+    /**
+     * detach thread local states from domain, taking
+     * any unpublished retire batches.  Waits for threads
+     * exiting, which publish their own.
+     */
+    void close_locals() {
+        std::vector<std::shared_ptr<smr_local>> _locals;
+        {
+            std::scoped_lock m(locals_mutex);
+            _locals.swap(locals);
+        }
+
+        for (auto& local : _locals)
+        {
+            std::unique_lock m2(local->mutex);
+            local->exit_cvar.wait(m2, [&] () { return !local->exiting; });
+            take_batch(local.get());        // other threads may be exiting
+            abandon(local.get());
+            for (auto& list : local->returned)
+                delete_batch(list.head, list.count, list.expiry, list.start);
+            local->returned.clear();
+            local->has_returned.store(false, std::memory_order_relaxed);
+
+            take_block(local.get());
+            local->domain = nullptr;
+            local->closed.store(true, std::memory_order_release);
+        }
+    }
+
+    /**
+     * delete linked list of objects, and any subtree objects released
+     * by their destructors, see retire_subtree()
+     * @param head head of null terminated linked list
+     * @param expiry batch expiry, stored into objects before delete
+     * @param budget maximum number of objects to delete, 0 = no limit
+     * @param deleted returns number of objects deleted, not counting subtree objects
+     * @return rest of list not deleted
+     */
+    smr_obj_base* delete_objects(smr_obj_base* head, epoch_t expiry, uint64_t budget = 0, uint64_t* deleted = nullptr)
+    {
+        uint64_t count = 0;
+        uint64_t size = 0;
+        uint64_t subtree_count = 0;
+        uint64_t start = smr_clock_ns();
+
+        smr_subtree subtree{this};
+        smr_subtree* outer = std::exchange(_smr_subtree, &subtree);
+
+        smr_obj_base* next = head;
+        while (next != nullptr && (budget == 0 || count < budget))
+        {
+            smr_obj_base* _obj = next;
+            next = next->smr_obj_next;
+            _obj->smr_obj_next = nullptr;
+            _obj->expiry.store(expiry, std::memory_order_relaxed);
+            size += _obj->smr_obj_size;
+            smr_dispose(_obj);
+            count++;
+
+            // released by destructors, unreachable since their parent was
+            while (subtree.head != nullptr)
+            {
+                smr_obj_base* child = subtree.head;
+                subtree.head = child->smr_obj_next;
+                child->smr_obj_next = nullptr;
+                child->expiry.store(expiry, std::memory_order_relaxed);
+                smr_dispose(child);
+                subtree_count++;
+            }
+        }
+
+        if (subtree.flush_frees != nullptr)
+            subtree.flush_frees();
+        _smr_subtree = outer;
+
+        uint64_t nsecs = smr_clock_ns() - start;
+        stats.delete_ns.fetch_add(nsecs, std::memory_order_relaxed);
+        stats.retired.fetch_add(subtree_count, std::memory_order_relaxed);
+        stats.deleted.fetch_add(count + subtree_count, std::memory_order_relaxed);
+        PROXY_PROBE(smrproxy, delete_objects, count + subtree_count, (uint64_t) expiry, nsecs);
+
+        if (bounded && count > 0)
+        {
+            outstanding_count.fetch_sub(count, std::memory_order_relaxed);
+            outstanding_bytes.fetch_sub(size, std::memory_order_relaxed);
+            space_seq.fetch_add(1, std::memory_order_seq_cst);
+            if (space_waiters.load(std::memory_order_seq_cst) != 0)
+                futex::wake(&space_seq, INT32_MAX);
+        }
+
+        if (deleted != nullptr)
+            *deleted = count;
+        return next;
+    }
+
+    /**
+     * delete whole batch and record its retire to delete latency
+     */
+    void delete_batch(smr_obj_base* head, uint64_t count, epoch_t expiry, uint64_t start)
+    {
+        delete_objects(head, expiry);
+        record_latency(start, count);
+    }
+
+    void record_latency(uint64_t start, uint64_t count)
+    {
+        if (start == 0)
+            return;
+        uint64_t usecs = (smr_clock_ns() - start) / 1000;
+        stats.latency[std::min<uint32_t>(std::bit_width(usecs), smr_metrics::latency_buckets - 1)].fetch_add(count, std::memory_order_relaxed);
+    }
+
+    /**
+     * delete lists of expired objects, or hand them off to deleter
+     * threads or executor
+     * @param expired batches
+     */
+    void dispose(std::vector<smr_batch>& expired)
+    {
+        if (expired.empty())
+            return;
+
+        if (return_to_owner)
+        {
+            return_owned(expired);
+            if (expired.empty())
+                return;
+        }
+
+        if (executor)
+        {
+            executor_pending.fetch_add(expired.size(), std::memory_order_relaxed);
+            for (smr_batch& batch : expired)
+                executor([this, batch] () {
+                    delete_batch(batch.head, batch.count, batch.expiry, batch.start);
+                    if (executor_pending.fetch_sub(1, std::memory_order_release) == 1)
+                        executor_pending.notify_all();
+                });
+        }
+        else if (deleters)
+        {
+            deleters->submit([this, expired = std::move(expired)] () {
+                for (const smr_batch& batch : expired)
+                    delete_batch(batch.head, batch.count, batch.expiry, batch.start);
+            });
+        }
+        else
+        {
+            delete_queue.insert(delete_queue.end(), expired.begin(), expired.end());
+        }
+        expired.clear();
+    }
+
+    /**
+     * hand expired batches back to the threads that retired them,
+     * leaving batches of exited threads in expired
+     */
+    static void return_owned(std::vector<smr_batch>& expired)
+    {
+        std::erase_if(expired, [] (smr_batch& batch) {
+            return batch.owner != nullptr && batch.owner->give({batch.head, batch.count, batch.expiry, batch.start});
+        });
+    }
+
+    /**
+     * delete expired objects on reclaim thread
+     * @param budget maximum number of objects to delete, 0 = no limit
+     * @return true if expired objects remain
+     */
+    bool delete_expired(uint32_t budget)
     {
+        uint64_t remaining = budget;
+        while (!delete_queue.empty())
+        {
+            smr_batch& batch = delete_queue.front();
+            uint64_t count;
+            smr_obj_base* next = delete_objects(batch.head, batch.expiry, remaining, &count);
+
+            if (next != nullptr)
+            {
+                batch.head = next;              // budget exhausted
+                return true;
+            }
+            record_latency(batch.start, batch.count);
+            delete_queue.pop_front();
+
+            if (budget != 0 && (remaining -= count) == 0)
+                return !delete_queue.empty();
+        }
+        return false;
+    }
+
+    /**
+     * @brief try reclaim, mutex must be held
+     * @param expired returns batches of expired objects, to be deleted w/o mutex held
+     * @return 
+     */
+    bool _try_reclaim(std::vector<smr_batch>& expired) {
+        if (_advance())
+        {
+            uint64_t start = smr_clock_ns();
+            _sync();
+            uint64_t nsecs = smr_clock_ns() - start;
+            stats.sync_ns.fetch_add(nsecs, std::memory_order_relaxed);
+            PROXY_PROBE(smrproxy, sync, (uint64_t) domain_epoch, nsecs);
+            synced_epoch = domain_epoch;
+        }
+
+        return _scan(expired);
+    }
+
+    /**
+     * move retire queue to defer queue w/ new epoch, mutex must be held
+     * @return true if memory barrier needed before scan
+     */
+    bool _advance() {
+        PROXY_PROBE(smrproxy, reclaim_start, (uint64_t) domain_epoch);
+        bool _urgent = urgent.exchange(false, std::memory_order_seq_cst);     // before tail, urgent object is in this batch or earlier
+        locals_pending = take_aged();       // before tail, published in this batch
+        uint64_t since = tail.load(std::memory_order_relaxed) != nullptr ? tail_since.exchange(0, std::memory_order_relaxed) : 0;  // before tail, see stamp_since()
+        smr_obj_base* _tail = tail.exchange(nullptr, std::memory_order_acquire);
+
+        size_t first = defer_queue.size();
+        if (return_to_owner)
+            take_owned();
+        if (_tail == nullptr && defer_queue.size() == first
+            && requested_epoch.load(std::memory_order_relaxed) <= domain_epoch)     // no grace period requested
+        {
+            if (_urgent)
+                urgent_expiry = domain_epoch;       // taken by an earlier advance
+            return false;
+        }
+
+        epoch_t expiry = domain_epoch;
+        expiry += 2;
+        std::atomic_ref(domain_epoch).store(expiry, std::memory_order_relaxed);    // read by retire()
+
+        for (size_t ndx = first; ndx < defer_queue.size(); ndx++)
+            defer_queue[ndx].expiry = expiry;
+
+        if (_tail != nullptr)
+        {
+            // count may lag a push in progress, evens out next advance
+            uint64_t total = tail_count.load(std::memory_order_relaxed);
+            uint64_t count = total - advanced_count;
+            advanced_count = total;
+
+            defer_queue.push_back({_tail, count, expiry, nullptr, since});
+            deferred_count += count;
+            stats.retired.fetch_add(count, std::memory_order_relaxed);
+        }
+        if (_urgent)
+            urgent_expiry = expiry;
+        return true;
+    }
+
+    /**
+     * move threads' own retire lists to defer queue as batches w/
+     * owner, expiry set by caller, mutex must be held
+     */
+    void take_owned() {
+        std::scoped_lock m(locals_mutex);
+        for (auto& local : locals)
         {
-            std::scoped_lock m(mutex);
+            if (local->retired.load(std::memory_order_relaxed) == nullptr)
+                continue;
+            uint64_t since = local->retired_since.exchange(0, std::memory_order_relaxed);   // before list, see stamp_since()
+            smr_obj_base* head = local->retired.exchange(nullptr, std::memory_order_acquire);
+            if (head == nullptr)
+                continue;                   // abandoned by exiting thread
+
+            uint64_t total = local->retired_count.load(std::memory_order_relaxed);
+            uint64_t count = total - local->advanced_count;
+            local->advanced_count = total;
+
+            defer_queue.push_back({head, count, epoch_t(0), local, since});
+            deferred_count += count;
+            stats.retired.fetch_add(count, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * publish threads' local batches and partial retire blocks not
+     * published within wait_ms, mutex must be held
+     * @return true if younger ones remain, reclaim polls until they age
+     */
+    bool take_aged() {
+        const uint64_t now = smr_clock_ns();
+        const uint64_t age = std::chrono::nanoseconds(wait_ms).count();
+        bool remaining = false;
 
-            while (active.load(std::memory_order_relaxed)) {
-                if (_try_reclaim())
-                    cvar.wait_for(mutex, wait_ms);
+        std::scoped_lock m(locals_mutex);
+        for (auto& local : locals)
+        {
+            if (local->head.load(std::memory_order_relaxed) != nullptr)
+            {
+                if (local->head_since.load(std::memory_order_relaxed) + age > now)
+                    remaining = true;
                 else
-                    cvar.wait(mutex);
+                    take_batch(local.get());
+            }
+            if (local->block.load(std::memory_order_relaxed) != nullptr)
+            {
+                if (local->block_since.load(std::memory_order_relaxed) + age > now)
+                    remaining = true;
+                else
+                    take_block(local.get());
+            }
+        }
+        return remaining;
+    }
+
+    static void _sync() {
+        if constexpr (_smrproxy_mb)
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);    // needed?
+        }
+        else
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            membarrier::sync();
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+    }
+
+    /**
+     * any retired objects not yet deleted, mutex must be held
+     */
+    bool _has_work() {
+        return !defer_queue.empty() || !delete_queue.empty() || wake_pending();
+    }
+
+    /**
+     * work published by other threads w/o holding mutex: retires,
+     * owned retire lists, local batches and blocks, grace period
+     * requests and awaiters.  These are published before checking
+     * for an idle reclaim thread, and rechecked by the reclaim thread
+     * after going idle, see sleep().
+     */
+    bool wake_pending() {
+        if (tail.load(std::memory_order_seq_cst) != nullptr)
+            return true;
+
+        if (gp_pending() || gp_awaiters.load(std::memory_order_seq_cst) != nullptr)
+            return true;
+
+        std::scoped_lock m(locals_mutex);
+        for (auto& local : locals)
+            if (local->retired.load(std::memory_order_seq_cst) != nullptr
+                || local->head.load(std::memory_order_seq_cst) != nullptr
+                || local->block.load(std::memory_order_seq_cst) != nullptr)
+                return true;
+        return false;
+    }
+
+    /**
+     * scan refs and collect expired objects, mutex must be held.
+     * Only batches w/ a memory barrier since their _advance(), i.e.
+     * expiry <= synced_epoch, are expired.
+     */
+    bool _scan(std::vector<smr_batch>& expired) {
+        /*
+        * set ref effective epochs and
+        * find oldest referenced epoch
+        */
+
+        uint64_t start = smr_clock_ns();
+        epoch_t oldest = refs->scan(domain_epoch);
+        stats.scan_ns.fetch_add(smr_clock_ns() - start, std::memory_order_relaxed);
+        stats.passes.fetch_add(1, std::memory_order_relaxed);
+        stats.epoch_lag.store(((uint64_t) domain_epoch - (uint64_t) oldest) / 2, std::memory_order_relaxed);
+
+        /*
+        * expire batches from the front until one is still
+        * referenced or not yet synced
+        */
+        while (!defer_queue.empty())
+        {
+            smr_batch& batch = defer_queue.front();
+            if (batch.expiry > oldest || batch.expiry > synced_epoch)
+                break;
+
+            expired.push_back(batch);
+            deferred_count -= batch.count;
+            defer_queue.pop_front();
+        }
+        stats.defer_batches.store(defer_queue.size(), std::memory_order_relaxed);
+        stats.deferred.store(deferred_count, std::memory_order_relaxed);
+
+        epoch_t completed = oldest < synced_epoch ? oldest : synced_epoch;
+        if (completed > completed_epoch.load(std::memory_order_relaxed))
+        {
+            completed_epoch.store(completed, std::memory_order_seq_cst);     // see synchronize()
+            if (gp_waiters.load(std::memory_order_seq_cst) != 0)
+            {
+                gp_seq.fetch_add(1, std::memory_order_release);
+                futex::wake(&gp_seq, INT32_MAX);
+            }
+        }
+        bool pending = !defer_queue.empty() || gp_pending() || gp_awaiters.load(std::memory_order_relaxed) != nullptr;
+        PROXY_PROBE(smrproxy, reclaim_end, (uint64_t) domain_epoch, (uint64_t) oldest, expired.size(), pending);
+
+        if (stall_ms.count() != 0 && pending)
+            check_stalls();
+
+        // urgent batch still deferred
+        bool _urgent = urgent_expiry != 0 && !defer_queue.empty() && defer_queue.front().expiry <= urgent_expiry;
+
+        // readers holding oldest epoch wake reclaim thread on unlock
+        if (unlock_hint || urgent_expiry != 0)
+            refs->hint_epoch.store(pending && (unlock_hint || _urgent) ? oldest : epoch_t(0), std::memory_order_relaxed);
+        if (!_urgent)
+            urgent_expiry = 0;
+
+        return pending || locals_pending;   // per ProxyType requirement
+    }
+
+    /**
+     * link suspended awaiter onto awaiter list
+     */
+    void push_awaiter(smr_grace_period* awaiter) {
+        smr_grace_period* next = gp_awaiters.load(std::memory_order_relaxed);
+        do {
+            awaiter->next = next;
+        } while (!gp_awaiters.compare_exchange_weak(next, awaiter, std::memory_order_seq_cst));
+
+        // wake idle reclaim thread, see sleep()
+        if (next == nullptr && wakeup.state.load(std::memory_order_seq_cst) == smr_wakeup::idle)
+            wakeup.wake();
+    }
+
+    /**
+     * resume awaiters w/ completed grace periods via their executors,
+     * called after a scan w/o mutex held
+     * @param all resume all awaiters, domain is being destroyed
+     */
+    void resume_awaiters(bool all = false) {
+        if (gp_awaiters.load(std::memory_order_relaxed) == nullptr)
+            return;
+
+        smr_grace_period* awaiter = gp_awaiters.exchange(nullptr, std::memory_order_acquire);
+        epoch_t completed = completed_epoch.load(std::memory_order_acquire);
+
+        smr_grace_period* head = nullptr;       // not yet completed
+        smr_grace_period* tail = nullptr;
+        while (awaiter != nullptr)
+        {
+            smr_grace_period* next = awaiter->next;
+            if (all || awaiter->cookie <= completed)
+            {
+                // awaiter may be destroyed once handle is resumed
+                smr_executor executor = std::move(awaiter->executor);
+                executor([handle = awaiter->handle] () { handle.resume(); });
+            }
+            else
+            {
+                awaiter->next = head;
+                head = awaiter;
+                if (tail == nullptr)
+                    tail = awaiter;
+            }
+            awaiter = next;
+        }
+
+        if (head != nullptr)
+        {
+            smr_grace_period* next = gp_awaiters.load(std::memory_order_relaxed);
+            do {
+                tail->next = next;
+            } while (!gp_awaiters.compare_exchange_weak(next, head, std::memory_order_release));
+        }
+    }
+
+    /**
+     * report readers pinning an epoch older than the domain epoch
+     * for longer than stall_ms, mutex must be held
+     */
+    void check_stalls() {
+        auto now = std::chrono::steady_clock::now();
+        refs->for_each([this, now] (smr_ref* ref) {
+            const uint32_t slot = refs->slot_id(ref);
+            if (slot >= stalls.size())
+                stalls.resize(slot + 1, {epoch_t(0), now, false});
+            stall_state& state = stalls[slot];
+
+            epoch_t effective_epoch = refs->effective_epoch(ref);
+            if (ref->_ref_epoch.load(std::memory_order_relaxed) == 0 || effective_epoch >= domain_epoch)
+            {
+                state.epoch = 0;                    // not pinning
+                return;
+            }
+
+            if (effective_epoch != state.epoch)
+            {
+                state = {effective_epoch, now, false};
+                return;
+            }
+
+            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(now - state.since);
+            if (state.reported || duration < stall_ms)
+                return;
+            state.reported = true;
+
+            smr_stall stall = {
+                slot,
+                ref->_owner_tid.load(std::memory_order_relaxed),
+                "",
+                state.epoch,
+                duration,
+                deferred_count,
+            };
+            stall.thread_name = thread_name(stall.tid);
+
+            if (stall_handler)
+                stall_handler(stall);
+            else
+                fprintf(stderr, "smrproxy: reader slot %u thread %d (%s) pinning epoch %lu for %lld ms, %lu objects deferred\n",
+                    stall.slot, stall.tid, stall.thread_name.c_str(),
+                    (uint64_t) stall.epoch, (long long) stall.duration.count(), stall.deferred);
+        });
+    }
+
+    static std::string thread_name(pid_t tid) {
+        char path[64];
+        char name[32] = "";
+        snprintf(path, sizeof(path), "/proc/self/task/%d/comm", tid);
+        if (FILE* file = fopen(path, "r"))
+        {
+            if (fgets(name, sizeof(name), file) == nullptr)
+                name[0] = 0;
+            fclose(file);
+        }
+        name[strcspn(name, "\n")] = 0;
+        return name;
+    }
+
+    /**
+     * requested grace period not yet completed
+     */
+    bool gp_pending() {
+        return completed_epoch.load(std::memory_order_relaxed) < requested_epoch.load(std::memory_order_seq_cst);
+    }
+
+    public:
+
+    /**
+     * Start a grace period if needed and return a cookie for
+     * poll_state().  The grace period completes once all readers
+     * holding a read lock at the time of the call have unlocked.
+     * @param expedite wake reclaim thread even if the grace period
+     * was already requested
+     */
+    epoch_t get_state(bool expedite = false) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);    // prior unlinks before epoch read
+        epoch_t cookie = std::atomic_ref(domain_epoch).load(std::memory_order_seq_cst);
+        cookie += 2;
+
+        // first request for a new grace period wakes reclaim thread
+        bool raised = false;
+        epoch_t requested = requested_epoch.load(std::memory_order_relaxed);
+        while (requested < cookie)
+        {
+            if (requested_epoch.compare_exchange_weak(requested, cookie, std::memory_order_seq_cst))
+            {
+                raised = true;
+                break;
             }
+        }
+
+        if (expedite || raised)
+            wakeup.wake();
+        return cookie;
+    }
+
+    /**
+     * @param cookie from get_state()
+     * @return true if the grace period has completed
+     */
+    bool poll_state(epoch_t cookie) {
+        return completed_epoch.load(std::memory_order_acquire) >= cookie;
+    }
+
+    /**
+     * Wait for all readers holding a read lock at the time of the
+     * call to unlock.  Must not be called while holding a read lock.
+     * @param expedited run a reclaim pass on the calling thread
+     * rather than waiting for the reclaim thread
+     */
+    void synchronize(bool expedited = false) {
+        epoch_t cookie = get_state(expedited);
+        if (expedited)
+            try_reclaim();
+
+        gp_waiters.fetch_add(1, std::memory_order_seq_cst);
+        for (;;)
+        {
+            uint32_t seq = gp_seq.load(std::memory_order_acquire);
+            if (poll_state(cookie))
+                break;
+            if (expedited)
+                wakeup.wake();
+            futex::wait(&gp_seq, seq, wait_ms);
+        }
+        gp_waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void synchronize_expedited() {
+        synchronize(true);
+    }
+
+    /**
+     * Awaitable grace period, e.g. co_await proxy.grace_period(executor).
+     * The coroutine is resumed via executor by the reclaim thread once
+     * all readers holding a read lock at the time of the call have
+     * unlocked.  Pending awaiters cost one list entry each.
+     */
+    smr_grace_period grace_period(smr_executor executor) {
+        return smr_grace_period(this, get_state(), std::move(executor));
+    }
+
+    /**
+     * Run callback after a grace period, e.g. to close a file
+     * descriptor or unmap memory readers may still be using.  The
+     * callback runs on whichever thread deletes expired objects.
+     */
+    void defer(std::function<void()> fn) {
+        retire(new smr_callback(std::move(fn)), sizeof(smr_callback));
+    }
+
+    /**
+     * run a reclaim pass on the calling thread, deleting expired
+     * objects on the calling thread
+     * @return true if objects pending reclaim
+     */
+    bool try_reclaim() {
+        std::vector<smr_batch> expired;
+        bool pending;
+        {
+            std::scoped_lock m(mutex);
+            pending = _try_reclaim(expired);
+        }
+        if (return_to_owner)
+            return_owned(expired);
+        for (smr_batch& batch : expired)
+            delete_batch(batch.head, batch.count, batch.expiry, batch.start);
+        resume_awaiters();
+        return pending;
+    }
+
+    /**
+     * next poll interval
+     * @param progress previous pass retired or expired objects
+     */
+    std::chrono::milliseconds poll_interval(bool progress)
+    {
+        if (urgent_expiry != 0)
+            return min_wait_ms;
+
+        if (!adaptive)
+            return wait_ms;
+
+        if (deferred_count > backlog_target)
+        {
+            backoff = 0;
+            auto interval = std::chrono::milliseconds(wait_ms.count() * backlog_target / deferred_count);
+            return std::max(interval, min_wait_ms);
+        }
+
+        if (progress)
+            backoff = 0;
+        else if (backoff < 16 && (wait_ms.count() << backoff) < max_wait_ms.count())
+            backoff++;
 
-            _try_reclaim();
+        return std::min(std::chrono::milliseconds(wait_ms.count() << backoff), max_wait_ms);
+    }
+
+    /**
+     * wait for retires or poll interval
+     * @param seq wake up sequence read before last reclaim pass
+     * @param pending objects pending reclaim, poll
+     */
+    void sleep(uint32_t seq, bool pending, std::chrono::milliseconds interval)
+    {
+        if (pending)
+        {
+            wakeup.state.store(smr_wakeup::polling, std::memory_order_seq_cst);
+            futex::wait(&wakeup.seq, seq, interval);
+        }
+        else
+        {
+            wakeup.state.store(smr_wakeup::idle, std::memory_order_seq_cst);
+            if (!wake_pending())            // published while not idle
+                futex::wait(&wakeup.seq, seq, std::chrono::nanoseconds(-1));
+        }
+        wakeup.state.store(smr_wakeup::awake, std::memory_order_relaxed);
+    }
+
+    void reclaim()
+    {
+        std::vector<smr_batch> expired;
+        std::unique_lock m(mutex);
+
+        for (;;) {
+            uint32_t seq = wakeup.seq.load(std::memory_order_acquire);
+            if (!active.load(std::memory_order_relaxed))
+                break;
+
+            uint64_t before = deferred_count;
+            bool pending = _try_reclaim(expired);
+            bool progress = !expired.empty() || deferred_count != before;
+            auto interval = poll_interval(progress);    // reads deferred_count, mutex held
+
+            m.unlock();
+            resume_awaiters();
+            dispose(expired);
+            bool deletes_pending = delete_expired(delete_budget);
+            if (stats_page != nullptr)
+                stats_page->publish(metrics());
+
+            if (!deletes_pending)                   // else next pass w/o waiting
+                sleep(seq, pending, interval);
+            m.lock();
         }
 
+        _try_reclaim(expired);
+
+        m.unlock();
+        dispose(expired);
+        delete_expired(0);
     }
 
 };
@@ -378,4 +3084,307 @@ private:
 static_assert(ProxyType<smrproxy, smr_ref, smr_obj_base>, "smrproxy does not meet ProxyType requirement");
 
 
+/**
+ * Read cursor for long traversals of lists, queues or trees.  Holds
+ * a read lock for its lifetime and, as it is moved from node to node,
+ * advances the lock's epoch when it reaches a retired node or every
+ * interval nodes, see smr_ref::advance_epoch(), so a long scan
+ * doesn't hold back objects retired since it started.
+ *
+ *    smr_cursor cursor(proxy, 64);
+ *    for (node* n = head.load(); n != nullptr; n = n->next.load())
+ *    {
+ *        cursor.advance(n);
+ *        ...
+ *    }
+ *
+ * After advance(n), only n and objects reached from it are protected,
+ * so pointers to earlier nodes must not be kept.  The ref must not
+ * be otherwise locked while the cursor is.
+ */
+class smr_cursor
+{
+    smr_ref* ref;
+    const uint32_t interval;
+    uint32_t count = 0;
+
+public:
+
+    /**
+     * @param interval advance epoch every interval nodes
+     */
+    smr_cursor(smr_ref& ref, uint32_t interval = 64) : ref(&ref), interval(std::max(interval, 1u))
+    {
+        ref.lock();
+    }
+
+    smr_cursor(smrproxy& domain, uint32_t interval = 64) : smr_cursor(*domain.local_ref(), interval) {}
+
+    ~smr_cursor()
+    {
+        ref->unlock();
+    }
+
+    smr_cursor(const smr_cursor&) = delete;
+    smr_cursor& operator=(const smr_cursor&) = delete;
+
+    /**
+     * cursor is now at node
+     */
+    void advance(const smr_obj_base* node)
+    {
+        if (++count >= interval || node->pre_expiry.load(std::memory_order_relaxed) != 0)
+        {
+            count = 0;
+            ref->advance_epoch(node);
+        }
+    }
+};
+
+
+/**
+ * Read lock handle not tied to a thread, e.g. for a coroutine
+ * holding a read lock across co_await and resuming on another
+ * thread.  Each lock() takes a reader slot from the locking thread's
+ * cache of free slots, or from the registry, and unlock() returns it
+ * to the unlocking thread's cache, so short read sections of many
+ * tasks reuse a few slots w/o contending on acquire_ref().
+ *
+ *    smr_task_ref ref(proxy);
+ *    {
+ *        std::scoped_lock m(ref);
+ *        ...
+ *        co_await ...;
+ *        ...
+ *    }
+ *
+ * Movable, not copyable.  Must be unlocked before the domain is
+ * destroyed.
+ */
+class smr_task_ref
+{
+    smrproxy* domain;
+    smr_ref* ref = nullptr;             // slot while locked
+
+public:
+
+    smr_task_ref(smrproxy& domain) : domain(&domain) {}
+
+    smr_task_ref(smr_task_ref&& other) noexcept
+        : domain(other.domain), ref(std::exchange(other.ref, nullptr)) {}
+
+    smr_task_ref& operator=(smr_task_ref&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (ref != nullptr)
+                unlock();
+            domain = other.domain;
+            ref = std::exchange(other.ref, nullptr);
+        }
+        return *this;
+    }
+
+    smr_task_ref(const smr_task_ref&) = delete;
+    smr_task_ref& operator=(const smr_task_ref&) = delete;
+
+    ~smr_task_ref()
+    {
+        if (ref != nullptr)
+            unlock();
+    }
+
+    void lock()
+    {
+        assert(ref == nullptr);
+        ref = domain->claim_task_ref();
+        ref->lock();
+    }
+
+    void unlock()
+    {
+        ref->unlock();
+        domain->release_task_ref(ref);
+        ref = nullptr;
+    }
+
+    bool locked() const { return ref != nullptr; }
+};
+
+
+inline bool smr_grace_period::await_ready()
+{
+    return domain->poll_state(cookie);
+}
+
+inline void smr_grace_period::await_suspend(std::coroutine_handle<> handle)
+{
+    this->handle = handle;
+    domain->push_awaiter(this);
+}
+
+inline void smr_local::exit()
+{
+    smrproxy* _domain;
+    std::vector<returned_list> _returned;
+    {
+        std::scoped_lock m(mutex);
+        exited = true;                  // no more returned lists
+        _returned.swap(returned);
+        has_returned.store(false, std::memory_order_relaxed);
+        _domain = domain;
+        exiting = _domain != nullptr;   // close_locals() waits
+    }
+
+    // w/o mutex, flush can reclaim, give() and take domain locks
+    if (_domain != nullptr)
+    {
+        _domain->flush(this);
+        _domain->abandon(this);
+        for (auto& list : _returned)
+            _domain->delete_batch(list.head, list.count, list.expiry, list.start);
+
+        std::scoped_lock m(mutex);
+        exiting = false;
+        exit_cvar.notify_all();
+    }
+    if (ref != nullptr)
+        registry->release(ref);
+    ref = nullptr;
+    for (smr_ref* task_ref : task_refs)
+        registry->release(task_ref);
+    task_refs.clear();
+}
+
+inline smr_local* smr_local_cache::_get(smrproxy* domain, const std::shared_ptr<smr_registry>& registry)
+{
+    // drop entries for destroyed domains
+    std::erase_if(entries, [] (auto& local) {
+        if (!local->closed.load(std::memory_order_acquire))
+            return false;
+        local->exit();
+        return true;
+    });
+
+    smr_local* local = nullptr;
+    for (auto& entry : entries)
+    {
+        if (entry->registry == registry)
+        {
+            local = entry.get();
+            break;
+        }
+    }
+
+    if (local == nullptr)
+    {
+        entries.push_back(domain->new_local());
+        local = entries.back().get();
+    }
+
+    last_registry = registry.get();
+    last_local = local;
+    return local;
+}
+
+
+inline void smr_reclaimer::run(worker& w)
+{
+    struct pending_t {
+        smrproxy* domain;
+        epoch_t epoch;          // domain epoch after advance
+        bool advanced;
+    };
+
+    std::vector<pending_t> pending;
+    std::vector<smrproxy::smr_batch> expired;
+
+    for (;;)
+    {
+        uint32_t seq = w.wakeup.seq.load(std::memory_order_acquire);
+        if (!active.load(std::memory_order_relaxed))
+            break;
+
+        bool polling = false;
+        bool deletes_pending = false;
+        bool idle = true;
+        std::chrono::milliseconds interval = std::chrono::milliseconds::max();
+
+        {
+            std::scoped_lock m(w.mutex);
+
+            // advance all domains w/ pending retires, one memory barrier for all
+            bool sync = false;
+            pending.clear();
+            for (smrproxy* domain : w.domains)
+            {
+                std::scoped_lock m2(domain->mutex);
+                if (!domain->_has_work())
+                    continue;
+                bool advanced = domain->_advance();
+                pending.push_back({domain, domain->domain_epoch, advanced});
+                sync |= advanced;
+            }
+
+            if (sync)
+            {
+                uint64_t start = smr_clock_ns();
+                smrproxy::_sync();
+                uint64_t sync_ns = smr_clock_ns() - start;
+                for (pending_t& p : pending)
+                    if (p.advanced)
+                    {
+                        p.domain->stats.sync_ns.fetch_add(sync_ns, std::memory_order_relaxed);
+                        PROXY_PROBE(smrproxy, sync, (uint64_t) p.epoch, sync_ns);
+                    }
+            }
+
+            for (pending_t& p : pending)
+            {
+                smrproxy* domain = p.domain;
+                bool _pending;
+                {
+                    std::scoped_lock m2(domain->mutex);
+                    if (p.advanced && p.epoch > domain->synced_epoch)
+                        domain->synced_epoch = p.epoch;
+                    _pending = domain->_scan(expired);
+
+                    if (_pending)
+                    {
+                        bool progress = p.advanced || !expired.empty();
+                        polling = true;
+                        interval = std::min(interval, domain->poll_interval(progress));
+                    }
+                }
+
+                domain->resume_awaiters();
+                domain->dispose(expired);
+                deletes_pending |= domain->delete_expired(domain->delete_budget);
+                if (domain->stats_page != nullptr)
+                    domain->stats_page->publish(domain->metrics());
+            }
+
+            if (!deletes_pending && !polling)
+            {
+                w.wakeup.state.store(smr_wakeup::idle, std::memory_order_seq_cst);
+                for (smrproxy* domain : w.domains)
+                    if (domain->wake_pending())     // published while not idle
+                        idle = false;
+            }
+        }
+
+        if (deletes_pending)
+            continue;                       // next pass w/o waiting
+        else if (polling)
+        {
+            w.wakeup.state.store(smr_wakeup::polling, std::memory_order_seq_cst);
+            futex::wait(&w.wakeup.seq, seq, interval);
+        }
+        else if (idle)
+            futex::wait(&w.wakeup.seq, seq, std::chrono::nanoseconds(-1));
+
+        w.wakeup.state.store(smr_wakeup::awake, std::memory_order_relaxed);
+    }
+}
+
 /*-*/
\ No newline at end of file
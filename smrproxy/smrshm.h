@@ -0,0 +1,657 @@
+/*
+   Copyright 2024 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <deque>
+#include <string>
+#include <functional>
+#include <chrono>
+#include <algorithm>
+#include <system_error>
+#include <stdexcept>
+
+#include <cstdio>
+#include <cstring>
+
+#include "smrproxy.h"
+
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+/**
+ * Offset of a T in an smrshm segment, for links between objects in
+ * the shared data area, which is mapped at a different address in
+ * each process.  0 = null.
+ */
+template<typename T>
+struct smr_offset
+{
+    uint64_t value = 0;
+
+    explicit operator bool() const { return value != 0; }
+    bool operator==(const smr_offset&) const = default;
+};
+
+static_assert(std::atomic<smr_offset<int>>::is_always_lock_free);
+
+
+/**
+ * reader slot in shared memory, one per reader thread
+ */
+struct alignas(64) smr_shm_slot
+{
+    static constexpr uint32_t cleaning = UINT32_MAX;    // pid while slot of dead process is freed or taken over
+
+    std::atomic<epoch_t> ref_epoch;         // set by lock(), 0 = not locked
+    std::atomic<uint32_t> pid;              // owner process, 0 = free, stored w/ release after start_time
+    std::atomic<uint64_t> start_time;       // owner process start time, detects pid reuse
+};
+
+static_assert(sizeof(smr_shm_slot) == 64);
+
+
+/**
+ * shared segment header, followed by the reader slots and the
+ * page aligned data area
+ */
+struct smr_shm_header
+{
+    static constexpr uint64_t magic_value = 0x31304d4853524d53;    // "SMRSHM01"
+
+    uint64_t magic;
+    uint32_t header_size;                   // sizeof(smr_shm_header), layout check
+    uint32_t nslots;
+    uint64_t data_offset;
+    uint64_t data_size;
+    uint32_t owner;                         // writer process
+    uint32_t mb;                            // SMRPROXY_MB, must match readers'
+
+    alignas(64) std::atomic<epoch_t> epoch;             // epoch readers lock, read-mostly
+    alignas(64) std::atomic<uint64_t> dead_readers;     // slots freed from dead processes
+
+    static constexpr uint64_t slots_offset = 64 * 3;
+
+    smr_shm_slot* slots() { return (smr_shm_slot*) ((char*) this + slots_offset); }
+};
+
+static_assert(sizeof(smr_shm_header) <= smr_shm_header::slots_offset);
+
+
+/**
+ * reader process liveness, by pid and process start time from
+ * /proc/<pid>/stat.  Processes must share a pid namespace.
+ */
+struct smr_process
+{
+    /**
+     * @return start time of calling process in clock ticks since boot
+     */
+    static uint64_t start_time()
+    {
+        uint64_t start = 0;
+        stat(getpid(), &start);
+        return start;
+    }
+
+    /**
+     * @param start process start time recorded when slot was claimed,
+     * 0 = being released, alive
+     * @return false if pid has exited, is a zombie, or was reused
+     */
+    static bool alive(uint32_t pid, uint64_t start)
+    {
+        if (start == 0)
+            return true;
+        if (kill(pid, 0) != 0 && errno == ESRCH)
+            return false;
+
+        uint64_t _start;
+        char state;
+        if (!stat(pid, &_start, &state))
+            return errno != ENOENT && errno != ESRCH;       // not readable, assume alive
+        return _start == start && state != 'Z' && state != 'X';
+    }
+
+private:
+
+    static bool stat(uint32_t pid, uint64_t* start, char* state = nullptr)
+    {
+        char path[64];
+        snprintf(path, sizeof(path), "/proc/%u/stat", pid);
+        FILE* file = fopen(path, "r");
+        if (file == nullptr)
+            return false;
+        char buf[1024];
+        size_t n = fread(buf, 1, sizeof(buf) - 1, file);
+        fclose(file);
+        buf[n] = 0;
+
+        // comm may contain spaces and parens, fields resume after last ')'
+        char* p = strrchr(buf, ')');
+        if (p == nullptr || p[1] == 0)
+            return false;
+        p += 2;
+        if (state != nullptr)
+            *state = *p;
+        for (int field = 3; field < 22 && p != nullptr; field++)    // starttime is field 22
+            if ((p = strchr(p, ' ')) != nullptr)
+                p++;
+        if (p == nullptr)
+            return false;
+        *start = strtoull(p, nullptr, 10);
+        return true;
+    }
+};
+
+
+/**
+ * Read lock on an smrshm segment, wait-free like smr_ref, held by
+ * one thread.  See smr_shm_segment::acquire_ref().
+ */
+class smr_shm_ref
+{
+    friend class smr_shm_segment;
+
+    smr_shm_slot* const slot;
+    const std::atomic<epoch_t>* const epoch;
+
+    smr_shm_ref(smr_shm_slot* slot, const std::atomic<epoch_t>* epoch) : slot(slot), epoch(epoch) {}
+
+public:
+
+    inline void lock()
+    {
+        epoch_t _epoch = epoch->load(std::memory_order_relaxed);
+        if constexpr(_smrproxy_mb)
+        {
+            slot->ref_epoch.store(_epoch, std::memory_order_seq_cst);
+        }
+        else
+        {
+            slot->ref_epoch.store(_epoch, std::memory_order_relaxed);
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+        }
+    }
+
+    inline void unlock()
+    {
+        slot->ref_epoch.store(0, std::memory_order_release);
+    }
+};
+
+
+/**
+ * Mapping of an smrshm segment, common to the writer, smrshm, and
+ * readers, smrshm_reader.
+ */
+class smr_shm_segment
+{
+protected:
+    std::string name;
+    char* base = nullptr;
+    size_t size = 0;
+    smr_shm_header* header = nullptr;
+
+    const uint64_t _start_time = smr_process::start_time();
+
+    /**
+     * map segment, creating it if nslots > 0
+     * @throws std::system_error, EEXIST if creating and name exists,
+     * e.g. left by a writer that crashed, shm_unlink() it first
+     */
+    smr_shm_segment(const char* name, uint32_t nslots = 0, size_t data_size = 0, mode_t mode = 0600) : name(name)
+    {
+        const bool create = nslots > 0;
+        int fd = create ? shm_open(name, O_CREAT | O_EXCL | O_RDWR, mode) : shm_open(name, O_RDWR, 0);
+        if (fd < 0)
+            throw std::system_error(errno, std::generic_category(), "shm_open");
+
+        const size_t page = sysconf(_SC_PAGESIZE);
+        uint64_t data_offset = (smr_shm_header::slots_offset + (uint64_t) nslots * sizeof(smr_shm_slot) + page - 1) & ~(page - 1);
+
+        struct stat st;
+        int err = 0;
+        if (create)
+        {
+            size = data_offset + data_size;
+            if (ftruncate(fd, size) != 0)
+                err = errno;
+        }
+        else if (fstat(fd, &st) == 0)
+            size = st.st_size;
+        else
+            err = errno;
+
+        if (err == 0 && size < sizeof(smr_shm_header))
+            err = EINVAL;
+
+        void* mem = err == 0 ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+        if (err == 0 && mem == MAP_FAILED)
+            err = errno;
+        close(fd);
+        if (err != 0)
+        {
+            if (create)
+                shm_unlink(name);
+            throw std::system_error(err, std::generic_category(), "smrshm map");
+        }
+
+        base = (char*) mem;
+        header = (smr_shm_header*) mem;
+
+        auto fail = [&] (int err, const char* what) {
+            munmap(mem, size);
+            if (create)
+                shm_unlink(name);
+            throw std::system_error(err, std::generic_category(), what);
+        };
+
+        if (create)
+        {
+            header->header_size = sizeof(smr_shm_header);
+            header->nslots = nslots;
+            header->data_offset = data_offset;
+            header->data_size = data_size;
+            header->owner = getpid();
+            header->mb = _smrproxy_mb;
+            header->epoch.store(1, std::memory_order_relaxed);
+            std::atomic_ref(header->magic).store(smr_shm_header::magic_value, std::memory_order_release);
+        }
+        else
+        {
+            // slots and data area within segment, data area page aligned after slots
+            if (std::atomic_ref(header->magic).load(std::memory_order_acquire) != smr_shm_header::magic_value
+                || header->header_size != sizeof(smr_shm_header)
+                || header->mb != _smrproxy_mb
+                || header->nslots == 0
+                || smr_shm_header::slots_offset + (uint64_t) header->nslots * sizeof(smr_shm_slot) > header->data_offset
+                || header->data_offset % page != 0
+                || header->data_offset > size
+                || header->data_size > size - header->data_offset)
+                fail(EPROTO, "smrshm layout");
+
+            // readers only write their slots
+            if (header->data_size > 0 && mprotect(base + header->data_offset, header->data_size, PROT_READ) != 0)
+                fail(errno, "smrshm mprotect");
+        }
+
+        if (membarrier::_register_global() != 0)
+            fail(errno, "membarrier register global");
+    }
+
+    ~smr_shm_segment()
+    {
+        munmap(base, size);
+    }
+
+public:
+
+    smr_shm_segment(const smr_shm_segment&) = delete;
+    smr_shm_segment& operator=(const smr_shm_segment&) = delete;
+
+    /**
+     * claim a reader slot, taking over slots of dead processes if none free
+     * @throws std::system_error if no slots left
+     */
+    smr_shm_ref* acquire_ref()
+    {
+        const uint32_t pid = getpid();
+        smr_shm_slot* slots = header->slots();
+
+        for (int pass = 0; pass < 2; pass++)
+        {
+            for (uint32_t ndx = 0; ndx < header->nslots; ndx++)
+            {
+                smr_shm_slot& slot = slots[ndx];
+                uint32_t owner = slot.pid.load(std::memory_order_acquire);
+                if (owner != 0 && (pass == 0 || owner == smr_shm_slot::cleaning
+                    || smr_process::alive(owner, slot.start_time.load(std::memory_order_relaxed))))
+                    continue;
+
+                // cleaning until start time is set, so the slot is never seen w/ our pid and the dead owner's start time
+                if (slot.pid.compare_exchange_strong(owner, smr_shm_slot::cleaning, std::memory_order_acquire, std::memory_order_relaxed))
+                {
+                    slot.ref_epoch.store(0, std::memory_order_relaxed);         // dead owner's
+                    slot.start_time.store(_start_time, std::memory_order_relaxed);
+                    slot.pid.store(pid, std::memory_order_release);
+                    if (owner != 0)
+                        header->dead_readers.fetch_add(1, std::memory_order_relaxed);
+                    return new smr_shm_ref(&slot, &header->epoch);
+                }
+            }
+        }
+
+        throw std::system_error(ENOSPC, std::generic_category(), "smrshm: out of reader slots");
+    }
+
+    /**
+     * release reader slot, ref should be unlocked
+     */
+    void release_ref(smr_shm_ref* ref)
+    {
+        smr_shm_slot* slot = ref->slot;
+        slot->ref_epoch.store(0, std::memory_order_release);
+        slot->start_time.store(0, std::memory_order_relaxed);
+        slot->pid.store(0, std::memory_order_release);
+        delete ref;
+    }
+
+    template<typename T>
+    T* get(smr_offset<T> offset) const
+    {
+        return offset.value != 0 ? (T*) (base + offset.value) : nullptr;
+    }
+
+    template<typename T>
+    smr_offset<T> offset_of(const T* ptr) const
+    {
+        return {ptr != nullptr ? (uint64_t) ((const char*) ptr - base) : 0};
+    }
+
+    /**
+     * shared data area, read only in readers
+     */
+    void* data() const { return base + header->data_offset; }
+    size_t data_size() const { return header->data_size; }
+
+    pid_t owner() const { return header->owner; }
+
+    /**
+     * reader slots freed from processes that exited w/o releasing them
+     */
+    uint64_t dead_readers() const { return header->dead_readers.load(std::memory_order_relaxed); }
+};
+
+
+/**
+ * smrshm configuration
+ */
+struct smrshm_config
+{
+    uint32_t slots = 256;           // reader slots, one per reader thread, fixed
+    size_t data_size = 0;           // shared data area
+    uint32_t wait_ms = 50;          // reclaim poll interval in milliseconds
+    uint32_t reap_ms = 1000;        // interval for freeing slots of dead readers while nothing is pending
+    mode_t mode = 0600;             // readers need read and write access
+
+    /**
+     * frees expired data by offset into the segment, called on the
+     * reclaim thread.  Required.
+     */
+    std::function<void(uint64_t)> deleter;
+};
+
+
+/**
+ * Cross-process smrproxy domain in named POSIX shared memory.
+ *
+ * The writer process creates the segment and retires offsets of data
+ * it allocated in the shared data area.  Reader processes attach w/
+ * smrshm_reader and get the same wait-free lock() and unlock() as
+ * smr_ref, through reader slots in the segment.  Reclaim runs in the
+ * writer process and uses a global expedited membarrier, which covers
+ * threads of the reader processes.
+ *
+ * A reader process that dies holding a read lock would hold back
+ * reclaim forever.  Reclaim checks the owner of each slot still
+ * pinning the same epoch as on the previous pass while objects are
+ * pending, and frees the slot if the process has exited or its pid
+ * was reused.  W/ nothing pending, slots of dead processes are freed
+ * every reap_ms.  Readers also take over slots of dead processes when
+ * none are free.
+ *
+ *    smrshm shm("/table", smrshm_config{.data_size = size, .deleter = ...});
+ *    ...
+ *    smrshm_reader reader("/table");             // reader process
+ *    smr_shm_ref* ref = reader.acquire_ref();
+ *    {
+ *        std::scoped_lock m(*ref);
+ *        table_t* table = reader.get(root->load());
+ *        ...
+ *    }
+ *
+ * The name is unlinked when the writer's domain is destroyed.
+ * Objects still pending then are freed, readers should have unlocked.
+ */
+class smrshm : public smr_shm_segment
+{
+    struct batch
+    {
+        std::vector<uint64_t> offsets;
+        epoch_t expiry;
+    };
+
+    std::mutex mutex;
+    std::condition_variable cvar;
+    bool active = true;                     // guarded by mutex
+    std::vector<uint64_t> pending;          // retired since last advance, guarded by mutex
+
+    // reclaim thread only
+    epoch_t domain_epoch = 1;
+    std::deque<batch> defer_queue;
+    std::vector<epoch_t> effective;         // effective epoch by slot
+
+    const std::chrono::milliseconds wait_ms;
+    const std::chrono::milliseconds reap_ms;
+    std::function<void(uint64_t)> deleter;
+    std::thread reclaim_task;
+
+public:
+
+    /**
+     * @throws std::invalid_argument if no deleter
+     * @throws std::system_error, see smr_shm_segment()
+     */
+    smrshm(const char* name, const smrshm_config& config)
+        : smr_shm_segment(name, std::max(checked(config).slots, 1u), config.data_size, config.mode),
+          effective(header->nslots, epoch_t(0)),
+          wait_ms(config.wait_ms),
+          reap_ms(config.reap_ms),
+          deleter(config.deleter)
+    {
+        reclaim_task = std::thread([this] () { this->reclaim(); });
+    }
+
+    ~smrshm()
+    {
+        {
+            std::scoped_lock m(mutex);
+            active = false;
+        }
+        cvar.notify_all();
+        reclaim_task.join();
+
+        advance(std::move(pending));
+        expire(scan());
+        for (batch& batch : defer_queue)
+            for (uint64_t offset : batch.offsets)
+                deleter(offset);
+
+        shm_unlink(name.c_str());
+    }
+
+    /**
+     * retire data at offset, freed by deleter once no reader in any
+     * process can hold a reference to it
+     */
+    void retire(uint64_t offset)
+    {
+        std::scoped_lock m(mutex);
+        pending.push_back(offset);
+    }
+
+    template<typename T>
+    void retire(smr_offset<T> offset)
+    {
+        retire(offset.value);
+    }
+
+private:
+
+    static const smrshm_config& checked(const smrshm_config& config)
+    {
+        if (!config.deleter)
+            throw std::invalid_argument("smrshm: deleter required");
+        return config;
+    }
+
+    /**
+     * move retired offsets to defer queue w/ new epoch and sync
+     */
+    void advance(std::vector<uint64_t>&& retired)
+    {
+        if (retired.empty())
+            return;
+
+        domain_epoch += 2;
+        defer_queue.push_back({std::move(retired), domain_epoch});
+
+        if constexpr (_smrproxy_mb)
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+        else
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            membarrier::sync_global();
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+    }
+
+    /**
+     * publish epoch, set slot effective epochs, freeing slots of dead
+     * processes holding back reclaim
+     * @return oldest referenced epoch
+     */
+    epoch_t scan()
+    {
+        if (header->epoch.load(std::memory_order_relaxed) != domain_epoch)
+            header->epoch.store(domain_epoch, std::memory_order_release);
+
+        epoch_t oldest = domain_epoch;
+        smr_shm_slot* slots = header->slots();
+        for (uint32_t ndx = 0; ndx < header->nslots; ndx++)
+        {
+            epoch_t ref_epoch = slots[ndx].ref_epoch.load(std::memory_order_relaxed);
+            epoch_t effective_epoch = effective[ndx];
+            if (ref_epoch == 0)
+                effective_epoch = domain_epoch;
+            else if (ref_epoch > effective_epoch)
+                effective_epoch = ref_epoch;
+            else if (!defer_queue.empty() && effective_epoch < defer_queue.front().expiry && reap(slots[ndx]))
+                effective_epoch = domain_epoch;         // pinned since last pass by dead process
+
+            effective[ndx] = effective_epoch;
+            if (effective_epoch < oldest)
+                oldest = effective_epoch;
+        }
+        return oldest;
+    }
+
+    /**
+     * free slot if its owner process is dead
+     * @return true if freed
+     */
+    bool reap(smr_shm_slot& slot)
+    {
+        uint32_t pid = slot.pid.load(std::memory_order_acquire);
+        if (pid == 0 || pid == smr_shm_slot::cleaning
+            || smr_process::alive(pid, slot.start_time.load(std::memory_order_relaxed)))
+            return false;
+
+        // readers taking over dead slots race on pid too
+        if (!slot.pid.compare_exchange_strong(pid, smr_shm_slot::cleaning, std::memory_order_acquire, std::memory_order_relaxed))
+            return false;
+
+        slot.ref_epoch.store(0, std::memory_order_relaxed);
+        slot.start_time.store(0, std::memory_order_relaxed);
+        slot.pid.store(0, std::memory_order_release);
+        header->dead_readers.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * free expired batches from the front of the defer queue
+     */
+    void expire(epoch_t oldest)
+    {
+        while (!defer_queue.empty() && defer_queue.front().expiry <= oldest)
+        {
+            for (uint64_t offset : defer_queue.front().offsets)
+                deleter(offset);
+            defer_queue.pop_front();
+        }
+    }
+
+    void reclaim()
+    {
+        auto reaped = std::chrono::steady_clock::now();
+        std::unique_lock m(mutex);
+        for (;;)
+        {
+            cvar.wait_for(m, wait_ms, [this] () { return !active; });
+            if (!active)
+                break;
+
+            std::vector<uint64_t> retired;
+            retired.swap(pending);
+            m.unlock();
+
+            advance(std::move(retired));
+            if (!defer_queue.empty())
+                expire(scan());
+            else if (std::chrono::steady_clock::now() - reaped >= reap_ms)
+            {
+                smr_shm_slot* slots = header->slots();
+                for (uint32_t ndx = 0; ndx < header->nslots; ndx++)
+                    reap(slots[ndx]);
+                reaped = std::chrono::steady_clock::now();
+            }
+
+            m.lock();
+        }
+    }
+};
+
+
+/**
+ * Reader process attachment to an smrshm segment.  Reader threads
+ * claim slots w/ acquire_ref().  The data area is mapped read only.
+ */
+class smrshm_reader : public smr_shm_segment
+{
+public:
+
+    /**
+     * @throws std::system_error if segment doesn't exist or layout doesn't match
+     */
+    smrshm_reader(const char* name) : smr_shm_segment(name) {}
+};
+
+
+/*-*/
@@ -0,0 +1,116 @@
+/*
+   Copyright 2024 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+ * smr_arena slots freed by the reclaim thread and reused by the
+ * owner, empty slabs returned to the heap
+ */
+
+#include "smrtest.h"
+
+#include <smrarena.h>
+
+#include <set>
+#include <vector>
+
+struct arena_node : public smr_arena_obj
+{
+    inline static std::atomic<uint64_t> deletes = 0;
+    inline static std::atomic<uint64_t> owner_deletes = 0;
+    inline static std::thread::id owner;
+
+    uint64_t value;
+
+    arena_node(uint64_t value = 0) : value(value) {}
+    ~arena_node() override
+    {
+        if (std::this_thread::get_id() == owner)
+            owner_deletes.fetch_add(1);
+        deletes.fetch_add(1);
+    }
+};
+
+static constexpr uint32_t per_slab = smr_slab::slot_space / sizeof(arena_node);
+
+/**
+ * create n nodes, retire them and wait for reclaim to delete them
+ */
+static std::vector<arena_node*> cycle(smrproxy& proxy, smr_arena<arena_node>& arena, uint32_t n)
+{
+    uint64_t deletes = arena_node::deletes.load();
+    std::vector<arena_node*> nodes;
+    for (uint32_t ndx = 0; ndx < n; ndx++)
+        nodes.push_back(arena.create(ndx));
+    for (arena_node* node : nodes)
+        proxy.retire(node);
+    CHECK(wait_for([&] () { return arena_node::deletes.load() == deletes + n; }));
+    return nodes;
+}
+
+int main()
+{
+    arena_node::owner = std::this_thread::get_id();
+
+    smrproxy proxy(smrproxy_config{.wait_ms = 2});
+
+    // slots freed by the reclaim thread are reused, no new slab
+    {
+        smr_arena<arena_node> arena;
+        auto first = cycle(proxy, arena, per_slab);
+        CHECK(arena.slab_count() == 1);
+
+        std::set<arena_node*> freed(first.begin(), first.end());
+        auto second = cycle(proxy, arena, per_slab);
+        CHECK(arena.slab_count() == 1);
+        for (arena_node* node : second)
+            CHECK(freed.contains(node));
+    }
+
+    // slabs emptied by reclaim are returned to the heap, keeping one spare
+    {
+        smr_arena<arena_node> arena;
+        cycle(proxy, arena, 4 * per_slab);
+        CHECK(arena.slab_count() == 4);
+
+        std::vector<arena_node*> nodes;
+        for (uint32_t ndx = 0; ndx < per_slab + 1; ndx++)      // reuse current slab, then a spare
+            nodes.push_back(arena.create(ndx));
+        CHECK(arena.slab_count() == 2);
+        uint64_t deletes = arena_node::deletes.load();
+        for (arena_node* node : nodes)
+            proxy.retire(node);
+        CHECK(wait_for([&] () { return arena_node::deletes.load() == deletes + nodes.size(); }));
+    }
+
+    // arena destroyed w/ objects pending, slabs freed by reclaim's last free
+    {
+        uint64_t deletes = arena_node::deletes.load();
+        {
+            smr_arena<arena_node> arena;
+            std::scoped_lock m(proxy);          // hold back reclaim
+            for (uint32_t ndx = 0; ndx < 2 * per_slab; ndx++)
+                proxy.retire(arena.create(ndx));
+        }
+        CHECK(wait_for([&] () { return arena_node::deletes.load() == deletes + 2 * per_slab; }));
+    }
+
+    // deleted on reclaim thread, not owner
+    CHECK(arena_node::owner_deletes.load() == 0);
+
+    return test_result("arena_test");
+}
+
+/*-*/
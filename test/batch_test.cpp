@@ -0,0 +1,86 @@
+/*
+   Copyright 2024 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+ * partial local retire batches and retire blocks deleted w/o
+ * flush() while the retiring thread is still running, w/ own
+ * reclaim thread and w/ a reclaim service
+ */
+
+#include "smrtest.h"
+
+using namespace std::chrono;
+
+/**
+ * object not derived from smr_obj_base, retired in retire blocks
+ */
+struct plain_obj
+{
+    inline static std::atomic<uint64_t> deletes = 0;
+
+    ~plain_obj() { deletes.fetch_add(1); }
+};
+
+static void test_domain(smrproxy& proxy)
+{
+    // bulk retires, well under bulk_batch
+    uint64_t deletes = test_obj::deletes.load();
+    for (int ndx = 0; ndx < 10; ndx++)
+        proxy.retire(new test_obj(ndx), smr_latency::bulk);
+    CHECK(wait_for([&] () { return test_obj::deletes.load() == deletes + 10; }));
+
+    // normal retires, under retire_batch
+    deletes = test_obj::deletes.load();
+    for (int ndx = 0; ndx < 3; ndx++)
+        proxy.retire(new test_obj(ndx));
+    CHECK(wait_for([&] () { return test_obj::deletes.load() == deletes + 3; }));
+
+    // low rate writer, batch never fills
+    deletes = test_obj::deletes.load();
+    for (int ndx = 0; ndx < 20; ndx++)
+    {
+        proxy.retire(new test_obj(ndx), smr_latency::bulk);
+        std::this_thread::sleep_for(milliseconds(5));
+    }
+    CHECK(wait_for([&] () { return test_obj::deletes.load() == deletes + 20; }));
+
+    // pointers w/ deleters, under retire block capacity
+    deletes = plain_obj::deletes.load();
+    for (int ndx = 0; ndx < 3; ndx++)
+        proxy.retire(new plain_obj());
+    proxy.retire(new plain_obj(), [] (void* p) { delete (plain_obj*) p; });
+    CHECK(wait_for([&] () { return plain_obj::deletes.load() == deletes + 4; }));
+}
+
+int main()
+{
+    // own reclaim thread
+    {
+        smrproxy proxy(smrproxy_config{.wait_ms = 5, .retire_batch = 8});
+        test_domain(proxy);
+    }
+
+    // reclaim service
+    {
+        smr_reclaimer service(1);
+        smrproxy proxy(smrproxy_config{.wait_ms = 5, .retire_batch = 8, .reclaimer = &service});
+        test_domain(proxy);
+    }
+
+    return test_result("batch_test");
+}
+
+/*-*/
@@ -0,0 +1,134 @@
+/*
+   Copyright 2024 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+ * bounded mode backpressure
+ */
+
+#include "smrtest.h"
+
+#include <stdexcept>
+
+static constexpr uint64_t max_retired = 16;
+
+int main()
+{
+    // retire_list accounting, outstanding objects return to 0
+    {
+        uint64_t deletes = test_obj::deletes.load();
+        smrproxy proxy(smrproxy_config{.wait_ms = 5, .max_retired = max_retired});
+
+        for (int ndx = 0; ndx < 1000; ndx++)
+        {
+            test_obj* objs[4];
+            for (int k = 0; k < 4; k++)
+                objs[k] = new test_obj(k);
+            for (int k = 0; k < 3; k++)
+                objs[k]->smr_obj_next = objs[k + 1];
+            proxy.retire_list(objs[0], objs[3], 4);
+
+            CHECK(proxy.metrics().outstanding <= max_retired + 4);
+        }
+
+        CHECK(wait_for([&] () { return test_obj::deletes.load() - deletes == 4000; }));
+        smr_metrics metrics = proxy.metrics();
+        CHECK(metrics.outstanding == 0);
+        CHECK(proxy.try_retire(new test_obj()));        // reservations all released
+        fprintf(stdout, "retire_list: blocked=%lu\n", proxy.backpressure_stats().blocked);
+    }
+
+    // retire_list w/ bad count or tail throws, nothing retired
+    {
+        smrproxy proxy(smrproxy_config{.wait_ms = 5, .max_retired = max_retired});
+        test_obj* objs[4];
+        for (int k = 0; k < 4; k++)
+            objs[k] = new test_obj(k);
+        for (int k = 0; k < 3; k++)
+            objs[k]->smr_obj_next = objs[k + 1];
+        objs[3]->smr_obj_next = nullptr;
+        test_obj other;
+
+        auto throws = [&] (smr_obj_base* tail, uint32_t count) {
+            try {
+                proxy.retire_list(objs[0], tail, count);
+            }
+            catch (const std::invalid_argument&) {
+                return true;
+            }
+            return false;
+        };
+
+        uint64_t deletes = test_obj::deletes.load();
+        CHECK(throws(objs[3], 3));
+        CHECK(throws(&other, 4));
+        CHECK(proxy.metrics().outstanding == 0);
+
+        proxy.retire_list(objs[0], objs[3], 4);
+        CHECK(wait_for([&] () { return test_obj::deletes.load() - deletes == 4; }));
+    }
+
+    // try_retire fails while a reader pins reclaim
+    {
+        smrproxy proxy(smrproxy_config{.wait_ms = 5, .max_retired = max_retired});
+        smr_ref* ref = proxy.acquire_ref();
+        ref->lock();
+        uint64_t retired = 0;
+        for (int ndx = 0; ndx < 100; ndx++)
+        {
+            test_obj* obj = new test_obj();
+            if (proxy.try_retire(obj))
+                retired++;
+            else
+                delete obj;
+        }
+        CHECK(retired == max_retired);
+        ref->unlock();
+        proxy.release_ref(ref);
+    }
+
+    // thread exit w/ return_to_owner, a pending retire block, and its
+    // own expired batch handed back while exit is publishing
+    {
+        static std::atomic<uint64_t> frees = 0;
+        uint64_t deletes = test_obj::deletes.load();
+        smrproxy proxy(smrproxy_config{.wait_ms = 5, .return_to_owner = true, .max_retired = 2});
+        std::atomic_bool retired = false;
+        std::atomic_bool exit = false;
+
+        smr_ref* ref = proxy.acquire_ref();
+        ref->lock();                                    // hold back reclaim
+
+        std::thread writer([&] () {
+            proxy.retire(new test_obj());
+            proxy.retire(new test_obj());               // at max_retired
+            proxy.retire(new int(0), [] (void* p) { delete (int*) p; frees.fetch_add(1); });
+            retired.store(true);
+            wait_for([&] () { return exit.load(); });
+        });
+
+        wait_for([&] () { return retired.load(); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));    // reclaim takes owned objects
+        exit.store(true);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));    // exit blocks on reserve
+        ref->unlock();
+        proxy.release_ref(ref);
+        writer.join();
+
+        CHECK(wait_for([&] () { return test_obj::deletes.load() - deletes == 2 && frees.load() == 1; }));
+    }
+
+    return test_result("bounded_test");
+}
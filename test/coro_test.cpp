@@ -0,0 +1,125 @@
+/*
+   Copyright 2024 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+ * co_await grace_period(), resumed by reclaim via an executor
+ */
+
+#include "smrtest.h"
+
+#include <coroutine>
+
+using namespace std::chrono;
+
+/**
+ * fire and forget coroutine, frame destroyed on completion
+ */
+struct task
+{
+    struct promise_type
+    {
+        task get_return_object() { return {}; }
+        std::suspend_never initial_suspend() { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+static std::atomic<int> executed = 0;
+
+static void inline_executor(std::function<void()> fn)
+{
+    executed.fetch_add(1);
+    fn();
+}
+
+static task wait_grace_period(smrproxy& proxy, std::atomic<int>& resumed)
+{
+    co_await proxy.grace_period(inline_executor);
+    resumed.fetch_add(1);
+}
+
+struct slow_obj : public smr_obj_base
+{
+    inline static std::atomic_bool deleting = false;
+
+    ~slow_obj() override
+    {
+        deleting.store(true);
+        std::this_thread::sleep_for(milliseconds(300));
+    }
+};
+
+static void test_domain(smrproxy& proxy)
+{
+    // resumed after reader locked before co_await unlocks
+    {
+        std::atomic<int> resumed = 0;
+        {
+            std::scoped_lock m(proxy);
+            for (int ndx = 0; ndx < 4; ndx++)
+                wait_grace_period(proxy, resumed);
+            std::this_thread::sleep_for(milliseconds(100));
+            CHECK(resumed.load() == 0);
+        }
+        CHECK(wait_for([&] () { return resumed.load() == 4; }));
+    }
+
+    // co_await while reclaim is running a slow destructor
+    {
+        std::atomic<int> resumed = 0;
+        slow_obj::deleting.store(false);
+        proxy.retire(new slow_obj());
+        CHECK(wait_for([] () { return slow_obj::deleting.load(); }));
+        wait_grace_period(proxy, resumed);
+        CHECK(wait_for([&] () { return resumed.load() == 1; }));
+    }
+}
+
+int main()
+{
+    {
+        smrproxy proxy(smrproxy_config{.wait_ms = 10});
+        test_domain(proxy);
+    }
+
+    {
+        smr_reclaimer service(1);
+        smrproxy proxy(smrproxy_config{.wait_ms = 10, .reclaimer = &service});
+        test_domain(proxy);
+    }
+
+    // awaiters pending at destruction are resumed
+    {
+        std::atomic<int> resumed = 0;
+        {
+            smrproxy proxy(smrproxy_config{.wait_ms = 10});
+            smr_ref* ref = proxy.acquire_ref();
+            ref->lock();
+            wait_grace_period(proxy, resumed);
+            ref->unlock();
+            proxy.release_ref(ref);
+        }
+        CHECK(resumed.load() == 1);
+    }
+
+    CHECK(executed.load() == 11);
+
+    return test_result("coro_test");
+}
+
+/*-*/
@@ -0,0 +1,120 @@
+/*
+   Copyright 2024 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+ * smr_cursor lets nodes retired behind it be reclaimed while it is
+ * held, its current node stays protected
+ */
+
+#include "smrtest.h"
+
+using namespace std::chrono;
+
+static constexpr int nnodes = 8;
+
+static std::atomic_bool node_deleted[nnodes];
+
+struct list_node : public smr_obj_base
+{
+    const int ndx;
+    std::atomic<list_node*> next = nullptr;
+
+    list_node(int ndx) : ndx(ndx) {}
+    ~list_node() override { node_deleted[ndx].store(true); }
+};
+
+/**
+ * @return true if node stays undeleted over a number of reclaim passes
+ */
+static bool pinned(int ndx)
+{
+    std::this_thread::sleep_for(milliseconds(200));
+    return !node_deleted[ndx].load();
+}
+
+int main()
+{
+    smrproxy proxy(smrproxy_config{.wait_ms = 10});
+
+    list_node* nodes[nnodes];
+    std::atomic<list_node*> head = nullptr;
+    for (int ndx = nnodes - 1; ndx >= 0; ndx--)
+    {
+        nodes[ndx] = new list_node(ndx);
+        nodes[ndx]->next.store(head.load());
+        head.store(nodes[ndx]);
+    }
+
+    {
+        smr_cursor cursor(proxy, 2);
+        list_node* n = head.load();
+        cursor.advance(n);                          // at n0
+        n = n->next.load();
+        cursor.advance(n);                          // at n1, epoch advanced
+
+        // n0 behind cursor unlinked and retired, held until cursor advances epoch
+        head.store(nodes[1]);
+        proxy.retire(nodes[0]);
+        CHECK(pinned(0));
+
+        // cursor moves on, n0 behind it is reclaimed while cursor is held
+        n = n->next.load();
+        cursor.advance(n);                          // at n2
+        n = n->next.load();
+        cursor.advance(n);                          // at n3, epoch advanced
+        CHECK(n == nodes[3]);
+        CHECK(wait_for([] () { return node_deleted[0].load(); }));
+
+        // current node retired, stays protected
+        nodes[2]->next.store(nodes[4]);
+        proxy.retire(nodes[3]);
+        CHECK(pinned(3));
+        CHECK(n->next.load() == nodes[4]);
+
+        // node retired ahead of cursor, reached via retired node, protected on arrival
+        nodes[2]->next.store(nodes[5]);
+        proxy.retire(nodes[4]);
+        std::this_thread::sleep_for(milliseconds(100));    // epoch advanced past n4's retire
+        n = n->next.load();
+        cursor.advance(n);                          // at n4, retired
+        CHECK(n == nodes[4]);
+        CHECK(pinned(4));
+        CHECK(n->next.load() == nodes[5]);
+
+        // n3 behind cursor reclaimed once cursor passes another interval
+        n = n->next.load();
+        cursor.advance(n);                          // at n5
+        n = n->next.load();
+        cursor.advance(n);                          // at n6, epoch advanced
+        CHECK(wait_for([] () { return node_deleted[3].load() && node_deleted[4].load(); }));
+        CHECK(!node_deleted[6].load());
+    }
+
+    // all retired nodes reclaimed after cursor is released
+    for (int ndx = 0; ndx < nnodes; ndx++)
+        if (ndx != 0 && ndx != 3 && ndx != 4)
+            proxy.retire(nodes[ndx]);
+    CHECK(wait_for([] () {
+        for (auto& d : node_deleted)
+            if (!d.load())
+                return false;
+        return true;
+    }));
+
+    return test_result("cursor_test");
+}
+
+/*-*/
@@ -0,0 +1,102 @@
+/*
+   Copyright 2024 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+ * expired objects deleted outside the domain mutex, by the reclaim
+ * thread w/ and w/o a delete budget, by deleter threads and by an
+ * executor, w/ destructors that retire and reclaim
+ */
+
+#include "smrtest.h"
+
+#include <unistd.h>
+
+using namespace std::chrono;
+
+static smrproxy* domain = nullptr;
+
+/**
+ * object whose destructor retires a child and runs a reclaim pass,
+ * which takes the domain mutex
+ */
+struct parent_obj : public smr_obj_base
+{
+    inline static std::atomic<uint64_t> deletes = 0;
+
+    ~parent_obj() override
+    {
+        domain->retire(new test_obj());
+        domain->try_reclaim();
+        deletes.fetch_add(1);
+    }
+};
+
+static void test_domain(const smrproxy_config& config)
+{
+    const uint64_t n = 20;
+    uint64_t parents = parent_obj::deletes.load();
+    uint64_t children = test_obj::deletes.load();
+
+    std::atomic_bool done = false;
+    std::thread thread([&] () {
+        smrproxy proxy(config);
+        domain = &proxy;
+        for (uint64_t ndx = 0; ndx < n; ndx++)
+            proxy.retire(new parent_obj());
+        if (wait_for([&] () {
+                return parent_obj::deletes.load() == parents + n
+                    && test_obj::deletes.load() == children + n;
+            }))
+            done.store(true);
+    });
+
+    // a delete under the mutex deadlocks in try_reclaim(), a hung thread can't be joined
+    if (!wait_for([&] () { return done.load(); }, milliseconds(10000)))
+    {
+        fprintf(stderr, "timed out\n");
+        test_result("delete_test");
+        _exit(1);
+    }
+    thread.join();
+
+    CHECK(parent_obj::deletes.load() == parents + n);
+    CHECK(test_obj::deletes.load() == children + n);
+}
+
+int main()
+{
+    // reclaim thread, all expired objects per pass
+    test_domain(smrproxy_config{.wait_ms = 2});
+
+    // reclaim thread, delete budget smaller than the batch
+    test_domain(smrproxy_config{.wait_ms = 2, .delete_budget = 3});
+
+    // deleter threads
+    test_domain(smrproxy_config{.wait_ms = 2, .delete_threads = 2});
+
+    // executor
+    std::atomic<uint64_t> tasks = 0;
+    test_domain(smrproxy_config{.wait_ms = 2,
+        .executor = [&] (std::function<void()> task) {
+            tasks.fetch_add(1);
+            std::thread(std::move(task)).detach();
+        }});
+    CHECK(tasks.load() > 0);
+
+    return test_result("delete_test");
+}
+
+/*-*/
@@ -0,0 +1,141 @@
+/*
+   Copyright 2024 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+ * synchronize(), defer(), get_state() and poll_state(), w/ own
+ * reclaim thread and w/ a reclaim service
+ */
+
+#include "smrtest.h"
+
+#include <unistd.h>
+
+using namespace std::chrono;
+
+/**
+ * object whose destructor takes a while, keeping reclaim awake
+ */
+struct slow_obj : public smr_obj_base
+{
+    inline static std::atomic_bool deleting = false;
+
+    ~slow_obj() override
+    {
+        deleting.store(true);
+        std::this_thread::sleep_for(milliseconds(300));
+    }
+};
+
+/**
+ * run fn on another thread, exiting if it doesn't return in time
+ * since a hung thread can't be joined
+ * @return true if fn returned in time
+ */
+template<typename F>
+static bool completes(F&& fn, milliseconds timeout = milliseconds(5000))
+{
+    std::atomic_bool done = false;
+    std::thread thread([&] () { fn(); done.store(true); });
+    if (!wait_for([&] () { return done.load(); }, timeout))
+    {
+        fprintf(stderr, "timed out\n");
+        test_result("grace_test");
+        _exit(1);
+    }
+    thread.join();
+    return true;
+}
+
+static void test_domain(smrproxy& proxy)
+{
+    // synchronize waits for a reader locked before the call
+    {
+        std::atomic_bool locked = false;
+        std::atomic_bool unlocked = false;
+        std::thread reader([&] () {
+            std::scoped_lock m(proxy);
+            locked.store(true);
+            std::this_thread::sleep_for(milliseconds(200));
+            unlocked.store(true);
+        });
+        wait_for([&] () { return locked.load(); });
+        completes([&] () { proxy.synchronize(); });
+        CHECK(unlocked.load());
+        reader.join();
+    }
+
+    // no readers
+    CHECK(completes([&] () { proxy.synchronize(); }));
+    CHECK(completes([&] () { proxy.synchronize_expedited(); }));
+
+    // get_state/poll_state
+    {
+        epoch_t cookie;
+        {
+            std::scoped_lock m(proxy);
+            cookie = proxy.get_state();
+            std::this_thread::sleep_for(milliseconds(100));
+            CHECK(!proxy.poll_state(cookie));
+        }
+        CHECK(wait_for([&] () { return proxy.poll_state(cookie); }));
+    }
+
+    // deferred callback runs after readers unlock
+    {
+        std::atomic_bool called = false;
+        {
+            std::scoped_lock m(proxy);
+            proxy.defer([&called] () { called.store(true); });
+            std::this_thread::sleep_for(milliseconds(100));
+            CHECK(!called.load());
+        }
+        CHECK(wait_for([&] () { return called.load(); }));
+    }
+
+    // grace period requested while reclaim is running a slow destructor
+    {
+        slow_obj::deleting.store(false);
+        proxy.retire(new slow_obj());
+        CHECK(wait_for([] () { return slow_obj::deleting.load(); }));
+        CHECK(completes([&] () { proxy.synchronize(); }));
+
+        slow_obj::deleting.store(false);
+        proxy.retire(new slow_obj());
+        CHECK(wait_for([] () { return slow_obj::deleting.load(); }));
+        epoch_t cookie = proxy.get_state();
+        CHECK(wait_for([&] () { return proxy.poll_state(cookie); }));
+    }
+}
+
+int main()
+{
+    {
+        smrproxy proxy(smrproxy_config{.wait_ms = 10});
+        test_domain(proxy);
+    }
+
+    {
+        smr_reclaimer service(1);
+        smrproxy proxy1(smrproxy_config{.wait_ms = 10, .reclaimer = &service});
+        smrproxy proxy2(smrproxy_config{.wait_ms = 10, .reclaimer = &service});
+        test_domain(proxy1);
+        test_domain(proxy2);
+    }
+
+    return test_result("grace_test");
+}
+
+/*-*/
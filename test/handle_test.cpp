@@ -0,0 +1,124 @@
+/*
+   Copyright 2024 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+ * smr_handle keeps smr_obj_counted objects alive past expiry
+ */
+
+#include "smrtest.h"
+
+using namespace std::chrono;
+
+struct counted_obj : public smr_obj_counted
+{
+    inline static std::atomic<uint64_t> deletes;
+
+    uint64_t value;
+
+    counted_obj(uint64_t value) : value(value) {}
+    ~counted_obj() override { deletes++; }
+};
+
+/**
+ * retire a plain object and wait for its delete, i.e. a reclaim pass
+ * has expired everything retired before it
+ */
+static bool reclaim_pass(smrproxy& proxy)
+{
+    uint64_t deletes = test_obj::deletes.load();
+    proxy.retire(new test_obj());
+    return wait_for([&] () { return test_obj::deletes.load() > deletes; });
+}
+
+int main()
+{
+    smrproxy proxy(smrproxy_config{.wait_ms = 10});
+    std::atomic<counted_obj*> shared = new counted_obj(1);
+
+    // no handles, deleted on expiry
+    {
+        proxy.retire(shared.exchange(new counted_obj(2)));
+        CHECK(reclaim_pass(proxy));
+        CHECK(counted_obj::deletes.load() == 1);
+    }
+
+    // handle outlives expiry, copies and moves counted, last reset deletes
+    {
+        smr_handle<counted_obj> h;
+        {
+            std::scoped_lock m(proxy);
+            h = smr_handle<counted_obj>(shared.load());
+        }
+        proxy.retire(shared.exchange(new counted_obj(3)));
+        CHECK(reclaim_pass(proxy));
+        CHECK(counted_obj::deletes.load() == 1);
+        CHECK(h->value == 2);
+
+        smr_handle<counted_obj> copy(h);
+        smr_handle<counted_obj> moved(std::move(h));
+        CHECK(!h);
+        CHECK(copy.get() == moved.get());
+
+        moved.reset();
+        CHECK(!moved);
+        CHECK(counted_obj::deletes.load() == 1);
+        CHECK(copy->value == 2);
+
+        h = copy;
+        copy = smr_handle<counted_obj>();
+        CHECK(counted_obj::deletes.load() == 1);
+        h.reset();
+        CHECK(counted_obj::deletes.load() == 2);
+    }
+
+    // handles released before expiry, domain's reference deletes
+    {
+        {
+            std::scoped_lock m(proxy);
+            smr_handle<counted_obj> h(shared.load());
+            smr_handle<counted_obj> copy = h;
+        }
+        proxy.retire(shared.exchange(new counted_obj(4)));
+        CHECK(reclaim_pass(proxy));
+        CHECK(counted_obj::deletes.load() == 3);
+    }
+
+    // handle passed to another thread, released there after expiry
+    {
+        smr_handle<counted_obj> h;
+        {
+            std::scoped_lock m(proxy);
+            h = smr_handle<counted_obj>(shared.load());
+        }
+        std::atomic_bool expired = false;
+        std::thread io([&expired, h = std::move(h)] () mutable {
+            wait_for([&] () { return expired.load(); });
+            CHECK(h->value == 4);
+            h.reset();
+        });
+
+        proxy.retire(shared.exchange(nullptr));
+        CHECK(reclaim_pass(proxy));
+        CHECK(counted_obj::deletes.load() == 3);
+        expired.store(true);
+        io.join();
+        CHECK(counted_obj::deletes.load() == 4);
+    }
+
+    return test_result("handle_test");
+}
+
+/*-*/
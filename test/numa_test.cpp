@@ -0,0 +1,88 @@
+/*
+   Copyright 2024 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+ * numa_scan w/ simulated nodes, readers on each node pin reclaim
+ */
+
+#include "smrtest.h"
+
+using namespace std::chrono;
+
+/**
+ * reader threads, on both simulated nodes by thread id, each in turn
+ * holds a read lock while an object is retired
+ */
+static void pin_each(smrproxy& proxy, int nreaders)
+{
+    for (int ndx = 0; ndx < nreaders; ndx++)
+    {
+        uint64_t deletes = test_obj::deletes.load();
+        std::atomic_bool locked = false;
+        std::atomic_bool release = false;
+        pid_t tid = 0;
+
+        std::thread reader([&] () {
+            tid = smr_gettid();
+            std::scoped_lock m(proxy);
+            locked.store(true);
+            while (!release.load())
+                std::this_thread::sleep_for(milliseconds(1));
+        });
+
+        wait_for([&] () { return locked.load(); });
+        proxy.retire(new test_obj());
+        std::this_thread::sleep_for(milliseconds(200));
+        bool pinned = test_obj::deletes.load() == deletes;
+        fprintf(stdout, "reader tid=%d node=%d pinned=%d\n", (int) tid, (int) (tid % 2), pinned);
+        CHECK(pinned);
+
+        release.store(true);
+        reader.join();
+        CHECK(wait_for([&] () { return test_obj::deletes.load() > deletes; }));
+    }
+}
+
+int main()
+{
+    smrproxy_config config = {.wait_ms = 10, .numa_scan = true, .numa_nodes = 2};
+
+    // own scanners
+    {
+        smrproxy proxy(config);
+        pin_each(proxy, 4);
+    }
+
+    // two domains sharing a reclaimer's scanners
+    {
+        smr_reclaimer service(1);
+        config.reclaimer = &service;
+        CHECK(service.numa_scanners(2) == service.numa_scanners(2));
+        CHECK(service.numa_scanners(2)->nodes() == 2);
+
+        smrproxy proxy1(config);
+        smrproxy proxy2(config);
+        pin_each(proxy1, 2);
+        pin_each(proxy2, 2);
+    }
+
+    // single node, no scanners
+    CHECK(smr_numa_scanners::create(1) == nullptr);
+
+    return test_result("numa_test");
+}
+
+/*-*/
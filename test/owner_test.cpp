@@ -0,0 +1,97 @@
+/*
+   Copyright 2024 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+ * return_to_owner mode, owned retire lists and bounded mode w/ an
+ * owner that stopped retiring
+ */
+
+#include "smrtest.h"
+
+using namespace std::chrono;
+
+/**
+ * object whose destructor keeps reclaim busy until released
+ */
+struct gated_obj : public smr_obj_base
+{
+    inline static std::atomic_bool deleting = false;
+    inline static std::atomic_bool release = false;
+
+    ~gated_obj() override
+    {
+        deleting.store(true);
+        wait_for([] () { return release.load(); });
+    }
+};
+
+int main()
+{
+    // retire onto owned list while a reclaim service is running a
+    // destructor of another domain
+    {
+        smr_reclaimer service(1);
+        smrproxy proxy1(smrproxy_config{.wait_ms = 10, .reclaimer = &service});
+        smrproxy proxy2(smrproxy_config{.wait_ms = 10, .return_to_owner = true, .reclaimer = &service});
+        proxy1.retire(new gated_obj());
+        std::thread writer([&] () {
+            uint64_t deletes = test_obj::deletes.load();
+            CHECK(wait_for([] () { return gated_obj::deleting.load(); }));
+            proxy2.retire(new test_obj());
+            gated_obj::release.store(true);
+            CHECK(wait_for([&] () {
+                proxy2.drain();
+                return test_obj::deletes.load() > deletes;
+            }));
+        });
+        writer.join();
+    }
+
+    // expired objects handed back to an idle owner don't block other writers
+    {
+        static constexpr uint64_t max_retired = 8;
+        uint64_t deletes = test_obj::deletes.load();
+        smrproxy proxy(smrproxy_config{.wait_ms = 5, .return_to_owner = true, .max_retired = max_retired});
+        std::atomic_bool retired = false;
+        std::atomic_bool exit = false;
+
+        std::thread owner([&] () {
+            for (uint64_t ndx = 0; ndx < max_retired; ndx++)
+                proxy.retire(new test_obj());
+            retired.store(true);
+            wait_for([&] () { return exit.load(); }, milliseconds(10000));     // not draining
+        });
+
+        wait_for([&] () { return retired.load(); });
+        std::this_thread::sleep_for(milliseconds(50));     // expired, handed back to owner
+
+        std::atomic_bool done = false;
+        std::thread writer([&] () {
+            proxy.retire(new test_obj());
+            done.store(true);
+        });
+        CHECK(wait_for([&] () { return done.load(); }, milliseconds(2000)));
+        CHECK(test_obj::deletes.load() > deletes);
+
+        exit.store(true);
+        owner.join();
+        writer.join();
+    }
+
+    return test_result("owner_test");
+}
+
+/*-*/
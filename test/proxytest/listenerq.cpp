@@ -84,7 +84,7 @@ struct queue_t {
         smr_ref* ref = proxy->acquire_ref();
 
         {
-            std::scoped_lock m(*ref);
+            smr_cursor cursor(*ref, 16);    // read lock, epoch advanced while walking events
 
             xnode<T>* node = tail.load(std::memory_order_acquire);
 
@@ -98,7 +98,7 @@ struct queue_t {
                 if (!listener(node))
                     break;
 
-                ref->update_epoch(node);
+                cursor.advance(node);
                 node = node->next.load(std::memory_order_acquire);
             }
 
@@ -4,6 +4,7 @@
 
 
 #include <smrproxy.h>
+#include <smrlite.h>
 #include <sharedproxy.h>
 #include <arcproxy.h>
 
@@ -30,6 +31,15 @@ static void execute(summary_t& summary, test_config_t& config, test_type test)
         }
         break;
 
+        case smrlite: {
+            class smrlite* const proxy = new class smrlite();
+
+            exec_test<smr_obj_base, smr_ref, class smrlite, std::mutex>(stats, proxy, &m, config);
+
+            delete proxy;
+        }
+        break;
+
         case arc: {
             arcproxy* proxy = new arcproxy(config.arc_size);
 
@@ -103,6 +113,12 @@ int main(int argc, char **argv)
             execute(summary ,config, smr);
             summary_t::print_summary(unsafe_summary, summary, "smr");
 
+            std::this_thread::yield();
+
+            summary = {};
+            execute(summary ,config, smrlite);
+            summary_t::print_summary(unsafe_summary, summary, "smrlite");
+
             if (test == all2)
                 break;
 
@@ -30,6 +30,7 @@ enum opts
 
 static testcase_t tests[] = {
     { smr, "smr", "smrproxy" },
+    { smrlite, "smrlite", "smrlite single writer smrproxy" },
     { arc, "arc", "arcproxy" },
     { rwlock, "rwlock", "rwlock based proxy" },
     { mutex, "mutex", "mutex based proxy" },
@@ -31,6 +31,7 @@ extern "C" {
 
 typedef enum {
     smr,            // smrproxy
+    smrlite,        // smrlite
     arc,            // arcproxy
     rwlock,         // sharedproxy
     mutex,          // mutexproxy
@@ -0,0 +1,119 @@
+/*
+   Copyright 2024 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+ * smr_reclaimer shared by many domains, domains added and removed
+ * while others are reclaiming, and shutdown w/ objects pending
+ */
+
+#include "smrtest.h"
+
+#include <memory>
+#include <vector>
+
+using namespace std::chrono;
+
+int main()
+{
+    // reclaim service w/o domains
+    {
+        smr_reclaimer service(2);
+    }
+
+    {
+        smr_reclaimer service(1);
+
+        // a domain pinned by a reader doesn't hold back another domain on the same worker
+        {
+            smrproxy pinned(smrproxy_config{.wait_ms = 2, .reclaimer = &service});
+            smrproxy other(smrproxy_config{.wait_ms = 2, .reclaimer = &service});
+
+            uint64_t deletes = test_obj::deletes.load();
+            std::atomic_bool locked = false;
+            std::atomic_bool release = false;
+            std::thread reader([&] () {
+                std::scoped_lock m(pinned);
+                locked.store(true);
+                wait_for([&] () { return release.load(); });
+            });
+            wait_for([&] () { return locked.load(); });
+
+            pinned.retire(new test_obj());
+            for (int ndx = 0; ndx < 10; ndx++)
+                other.retire(new test_obj());
+            CHECK(wait_for([&] () { return test_obj::deletes.load() == deletes + 10; }));
+            std::this_thread::sleep_for(milliseconds(20));
+            CHECK(test_obj::deletes.load() == deletes + 10);
+
+            release.store(true);
+            reader.join();
+            CHECK(wait_for([&] () { return test_obj::deletes.load() == deletes + 11; }));
+        }
+
+        // domain destroyed w/ objects still deferred, deleted by its destructor
+        {
+            uint64_t deletes = test_obj::deletes.load();
+            {
+                smrproxy proxy(smrproxy_config{.wait_ms = 2, .reclaimer = &service});
+                std::scoped_lock m(proxy);
+                for (int ndx = 0; ndx < 10; ndx++)
+                    proxy.retire(new test_obj());
+                std::this_thread::sleep_for(milliseconds(10));
+                CHECK(test_obj::deletes.load() == deletes);
+            }
+            CHECK(test_obj::deletes.load() == deletes + 10);
+        }
+    }
+
+    // domains added and removed by several threads while others reclaim
+    {
+        smr_reclaimer service(2);
+        smrproxy resident(smrproxy_config{.wait_ms = 2, .reclaimer = &service});
+
+        const int nthreads = 4;
+        const int rounds = 20;
+        const int per_round = 50;
+        std::atomic<uint64_t> retires = 0;
+        uint64_t deletes = test_obj::deletes.load();
+
+        std::vector<std::thread> threads;
+        for (int ndx = 0; ndx < nthreads; ndx++)
+            threads.emplace_back([&] () {
+                for (int round = 0; round < rounds; round++)
+                {
+                    smrproxy proxy(smrproxy_config{.wait_ms = 2, .reclaimer = &service});
+                    for (int obj = 0; obj < per_round; obj++)
+                    {
+                        std::scoped_lock m(proxy);
+                        proxy.retire(new test_obj(obj));
+                        resident.retire(new test_obj(obj));
+                    }
+                    retires.fetch_add(2 * per_round);
+                    if (round % 2 == 0)
+                        proxy.synchronize();
+                }
+            });
+        for (auto& thread : threads)
+            thread.join();
+
+        CHECK(retires.load() == (uint64_t) nthreads * rounds * per_round * 2);
+        CHECK(wait_for([&] () { return test_obj::deletes.load() == deletes + retires.load(); }));
+    }
+
+    return test_result("reclaimer_test");
+}
+
+/*-*/
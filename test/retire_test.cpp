@@ -0,0 +1,86 @@
+/*
+   Copyright 2024 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+ * retire of pointers w/ deleters, published on thread exit
+ */
+
+#include "smrtest.h"
+
+static std::atomic<uint64_t> frees = 0;
+
+static void free_int(void* p)
+{
+    delete (int*) p;
+    frees.fetch_add(1);
+}
+
+int main()
+{
+    // several domains, some bounded, blocks published by thread exit
+    {
+        smrproxy proxy1(smrproxy_config{.wait_ms = 5});
+        smrproxy proxy2(smrproxy_config{.wait_ms = 5, .max_retired = 1});
+        smrproxy proxy3(smrproxy_config{.wait_ms = 5, .return_to_owner = true, .max_retired = 1});
+
+        std::thread writer([&] () {
+            for (int ndx = 0; ndx < 10; ndx++)
+            {
+                proxy1.retire(new int(ndx), free_int);
+                proxy2.retire(new int(ndx), free_int);
+                proxy3.retire(new int(ndx), free_int);
+            }
+            proxy2.retire(new test_obj());          // block reserves over limit on exit
+        });
+        writer.join();
+
+        CHECK(wait_for([] () { return frees.load() == 30; }));
+    }
+    CHECK(frees.load() == 30);
+
+    // thread exit w/ cache entry of a destroyed domain and bounded
+    // backpressure on exit, exit path must not modify the thread's cache
+    {
+        smrproxy proxy1(smrproxy_config{.wait_ms = 5, .max_retired = 1});
+        auto proxy2 = std::make_unique<smrproxy>(smrproxy_config{.wait_ms = 5});
+        std::atomic_bool retired = false;
+        std::atomic_bool destroyed = false;
+
+        smr_ref* ref = proxy1.acquire_ref();
+        ref->lock();                                    // hold back reclaim
+
+        std::thread writer([&] () {
+            proxy1.retire(new int(1), free_int);        // unpublished block
+            proxy1.retire(new test_obj());              // at max_retired
+            proxy2->retire(new int(0), free_int);
+            proxy2->flush();
+            retired.store(true);
+            wait_for([&] () { return destroyed.load(); });
+        });
+
+        wait_for([&] () { return retired.load(); });
+        proxy2.reset();
+        destroyed.store(true);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));   // writer exit blocks on reserve
+        ref->unlock();
+        proxy1.release_ref(ref);
+        writer.join();
+
+        CHECK(wait_for([] () { return frees.load() == 32; }));
+    }
+
+    return test_result("retire_test");
+}
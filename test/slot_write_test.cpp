@@ -0,0 +1,85 @@
+/*
+   Copyright 2024 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+ * reclaim passes never store to reader slot lines.  A page of claimed
+ * reader slots is made read only while objects are retired and
+ * reclaimed, a store by the reclaim thread faults.
+ */
+
+#include "smrtest.h"
+
+#include <set>
+#include <vector>
+
+#include <unistd.h>
+#include <sys/mman.h>
+
+using namespace std::chrono;
+
+int main()
+{
+    smrproxy proxy(smrproxy_config{.wait_ms = 2});
+
+    // claim slots until a page holds only claimed slots
+    const uintptr_t page = sysconf(_SC_PAGESIZE);
+    std::vector<smr_ref*> refs;
+    std::set<uintptr_t> claimed;
+    char* slots = nullptr;
+    for (int ndx = 0; ndx < 1024 && slots == nullptr; ndx++)
+    {
+        smr_ref* ref = proxy.acquire_ref();
+        refs.push_back(ref);
+        claimed.insert((uintptr_t) ref);
+
+        uintptr_t start = (uintptr_t) ref & ~(page - 1);
+        bool full = true;
+        for (uintptr_t addr = start; addr < start + page && full; addr += sizeof(smr_ref))
+            full = claimed.contains(addr);
+        if (full)
+            slots = (char*) start;
+    }
+    CHECK(slots != nullptr);
+    if (slots == nullptr)
+        return test_result("slot_write_test");
+
+    smr_ref* pinned = (smr_ref*) slots;
+    uint64_t deletes = test_obj::deletes.load();
+
+    // unlocked slots
+    CHECK(mprotect(slots, page, PROT_READ) == 0);
+    for (int ndx = 0; ndx < 10; ndx++)
+        proxy.retire(new test_obj());
+    CHECK(wait_for([&] () { return test_obj::deletes.load() == deletes + 10; }));
+    CHECK(mprotect(slots, page, PROT_READ | PROT_WRITE) == 0);
+
+    // locked slot pinning reclaim, scanned every pass
+    pinned->lock();
+    CHECK(mprotect(slots, page, PROT_READ) == 0);
+    proxy.retire(new test_obj());
+    std::this_thread::sleep_for(milliseconds(100));
+    CHECK(test_obj::deletes.load() == deletes + 10);
+    CHECK(mprotect(slots, page, PROT_READ | PROT_WRITE) == 0);
+    pinned->unlock();
+    CHECK(wait_for([&] () { return test_obj::deletes.load() == deletes + 11; }));
+
+    for (smr_ref* ref : refs)
+        proxy.release_ref(ref);
+
+    return test_result("slot_write_test");
+}
+
+/*-*/
@@ -0,0 +1,236 @@
+/*
+   Copyright 2024 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+ * smrshm w/ reader processes, one killed while holding a read lock
+ */
+
+#include "smrtest.h"
+
+#include <smrshm.h>
+
+#include <stdexcept>
+
+#include <signal.h>
+#include <sys/wait.h>
+
+using namespace std::chrono;
+
+struct shm_node
+{
+    std::atomic<uint64_t> valid;            // 1 while not freed
+};
+
+struct shm_data
+{
+    std::atomic<smr_offset<shm_node>> root;
+    shm_node nodes[256];
+};
+
+/**
+ * reader process, checks every node it reaches under lock is valid
+ * @return exit status, nonzero if a freed node was seen
+ */
+static int reader(const char* name, milliseconds duration)
+{
+    smrshm_reader r(name);
+    smr_shm_ref* ref = r.acquire_ref();
+    shm_data* data = (shm_data*) r.data();
+    auto deadline = steady_clock::now() + duration;
+    int bad = 0;
+    for (uint64_t ndx = 0; (ndx % 1024) != 0 || steady_clock::now() < deadline; ndx++)
+    {
+        std::scoped_lock m(*ref);
+        shm_node* node = r.get(data->root.load(std::memory_order_acquire));
+        if (node->valid.load(std::memory_order_relaxed) != 1)
+            bad++;
+    }
+    r.release_ref(ref);
+    return bad == 0 ? 0 : 1;
+}
+
+/**
+ * fork reader process that locks and waits to be killed
+ * @return pid once locked
+ */
+static pid_t locked_reader(const char* name)
+{
+    int fds[2];
+    CHECK(pipe(fds) == 0);
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        smrshm_reader r(name);
+        smr_shm_ref* ref = r.acquire_ref();
+        ref->lock();
+        char c = 1;
+        (void) !write(fds[1], &c, 1);
+        for (;;)
+            pause();
+    }
+    char c;
+    CHECK(read(fds[0], &c, 1) == 1);
+    close(fds[0]);
+    close(fds[1]);
+    return pid;
+}
+
+static void kill_reader(pid_t pid)
+{
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+}
+
+int main()
+{
+    char name[64];
+    snprintf(name, sizeof(name), "/smrshm_test.%d", (int) getpid());
+
+    // deleter required
+    bool invalid = false;
+    try {
+        smrshm shm(name, smrshm_config{.data_size = 4096});
+    }
+    catch (std::invalid_argument&) {
+        invalid = true;
+    }
+    CHECK(invalid);
+
+    std::mutex free_mutex;
+    std::vector<uint32_t> free_nodes;       // guarded by free_mutex
+    std::atomic<uint64_t> deletes = 0;
+    smrshm* pshm = nullptr;
+
+    const uint32_t nslots = 8;
+    smrshm shm(name, smrshm_config{.slots = nslots, .data_size = sizeof(shm_data), .wait_ms = 2, .reap_ms = 50,
+        .deleter = [&] (uint64_t offset) {
+            shm_node* node = pshm->get(smr_offset<shm_node>{offset});
+            node->valid.store(0);
+            std::scoped_lock m(free_mutex);
+            free_nodes.push_back(node - ((shm_data*) pshm->data())->nodes);
+            deletes++;
+        }});
+    pshm = &shm;
+
+    shm_data* data = (shm_data*) shm.data();
+    for (uint32_t ndx = 1; ndx < std::size(data->nodes); ndx++)
+        free_nodes.push_back(ndx);
+    data->nodes[0].valid.store(1);
+    data->root.store(shm.offset_of(&data->nodes[0]));
+
+    // name in use
+    int err = 0;
+    try {
+        smrshm shm2(name, smrshm_config{.deleter = [] (uint64_t) {}});
+    }
+    catch (std::system_error& e) {
+        err = e.code().value();
+    }
+    CHECK(err == EEXIST);
+
+    // slots overlapping data area
+    int fd = shm_open(name, O_RDWR, 0);
+    void* mem = fd >= 0 ? mmap(nullptr, sizeof(smr_shm_header), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    CHECK(mem != MAP_FAILED);
+    if (fd >= 0)
+        close(fd);
+    if (mem != MAP_FAILED)
+    {
+        smr_shm_header* header = (smr_shm_header*) mem;
+        uint32_t nslots = header->nslots;
+        header->nslots = header->data_offset / sizeof(smr_shm_slot);
+
+        err = 0;
+        try {
+            smrshm_reader r(name);
+        }
+        catch (std::system_error& e) {
+            err = e.code().value();
+        }
+        CHECK(err == EPROTO);
+
+        header->nslots = nslots;
+        munmap(mem, sizeof(smr_shm_header));
+    }
+
+    // reader killed holding a read lock pins reclaim until its slot is freed
+    pid_t dead = locked_reader(name);
+
+    shm_node* old = shm.get(data->root.load());
+    data->nodes[1].valid.store(1);
+    {
+        std::scoped_lock m(free_mutex);
+        std::erase(free_nodes, 1u);
+    }
+    shm.retire(data->root.exchange(shm.offset_of(&data->nodes[1])));
+    std::this_thread::sleep_for(milliseconds(100));
+    CHECK(deletes.load() == 0 && old->valid.load() == 1);
+
+    kill_reader(dead);
+    CHECK(wait_for([&] () { return deletes.load() == 1; }));
+    CHECK(shm.dead_readers() == 1);
+
+    // slot of reader killed w/ nothing pending freed by timer
+    kill_reader(locked_reader(name));
+    CHECK(wait_for([&] () { return shm.dead_readers() == 2; }));
+
+    // all slots held by killed readers, live readers take them over,
+    // racing each other and the writer's reaping, while root is
+    // replaced and old nodes freed
+    pid_t dead_readers[nslots];
+    for (uint32_t ndx = 0; ndx < nslots; ndx++)
+        dead_readers[ndx] = locked_reader(name);
+    for (uint32_t ndx = 0; ndx < nslots; ndx++)
+        kill_reader(dead_readers[ndx]);
+
+    const int nreaders = nslots;
+    for (int ndx = 0; ndx < nreaders; ndx++)
+        if (fork() == 0)
+            _exit(reader(name, milliseconds(500)));
+
+    uint64_t retires = 1;
+    for (int live = nreaders; live > 0;)
+    {
+        uint32_t ndx = 0;
+        {
+            std::scoped_lock m(free_mutex);
+            if (!free_nodes.empty())
+            {
+                ndx = free_nodes.back();
+                free_nodes.pop_back();
+            }
+        }
+        if (ndx != 0)
+        {
+            data->nodes[ndx].valid.store(1);
+            shm.retire(data->root.exchange(shm.offset_of(&data->nodes[ndx])));
+            retires++;
+        }
+        std::this_thread::sleep_for(microseconds(100));
+
+        int status;
+        for (pid_t pid; (pid = waitpid(-1, &status, WNOHANG)) > 0; live--)
+            CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+    CHECK(wait_for([&] () { return deletes.load() == retires; }));
+    CHECK(shm.dead_readers() == 2 + nslots);
+    fprintf(stdout, "retires=%lu deletes=%lu dead_readers=%lu\n",
+        (unsigned long) retires, (unsigned long) deletes.load(), (unsigned long) shm.dead_readers());
+
+    return test_result("smrshm_test");
+}
+
+/*-*/
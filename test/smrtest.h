@@ -0,0 +1,78 @@
+/*
+   Copyright 2024 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <stdio.h>
+
+#include <smrproxy.h>
+
+/**
+ * check helpers for smrproxy tests, a failed check is reported and
+ * the test exits w/ nonzero status
+ */
+inline int _smrtest_failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            _smrtest_failures++; \
+        } \
+    } while (0)
+
+inline int test_result(const char* name)
+{
+    fprintf(stdout, "%s: %s\n", name, _smrtest_failures == 0 ? "passed" : "failed");
+    return _smrtest_failures == 0 ? 0 : 1;
+}
+
+/**
+ * wait up to timeout for pred
+ * @return true if pred became true
+ */
+template<typename F>
+bool wait_for(F&& pred, std::chrono::milliseconds timeout = std::chrono::milliseconds(5000))
+{
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!pred())
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+/**
+ * managed object counting its deletes
+ */
+struct test_obj : public smr_obj_base
+{
+    inline static std::atomic<uint64_t> deletes = 0;
+
+    uint64_t value;
+
+    test_obj(uint64_t value = 0) : value(value) {}
+    ~test_obj() override { deletes.fetch_add(1); }
+};
+
+
+/*-*/
@@ -0,0 +1,100 @@
+/*
+   Copyright 2024 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+ * reader stall watchdog, a stalled reader reported once w/ its
+ * thread id and name, short holds not reported
+ */
+
+#include "smrtest.h"
+
+#include <mutex>
+#include <vector>
+
+#include <pthread.h>
+
+using namespace std::chrono;
+
+static std::mutex stalls_mutex;
+static std::vector<smr_stall> stalls;      // guarded by stalls_mutex
+
+static size_t stall_count()
+{
+    std::scoped_lock m(stalls_mutex);
+    return stalls.size();
+}
+
+/**
+ * named reader thread holding a read lock for hold while an object
+ * it pins is retired
+ * @return reader's tid
+ */
+static pid_t pin(smrproxy& proxy, milliseconds hold)
+{
+    std::atomic<pid_t> tid = 0;
+    std::atomic_bool locked = false;
+    std::thread reader([&] () {
+        pthread_setname_np(pthread_self(), "stall_reader");
+        tid.store(gettid());
+        std::scoped_lock m(proxy);
+        locked.store(true);
+        std::this_thread::sleep_for(hold);
+    });
+    wait_for([&] () { return locked.load(); });
+    proxy.retire(new test_obj());
+    reader.join();
+    return tid.load();
+}
+
+int main()
+{
+    smrproxy proxy(smrproxy_config{.wait_ms = 5, .stall_ms = 50,
+        .stall_handler = [] (const smr_stall& stall) {
+            std::scoped_lock m(stalls_mutex);
+            stalls.push_back(stall);
+        }});
+
+    // held well under stall_ms
+    pin(proxy, milliseconds(10));
+    std::this_thread::sleep_for(milliseconds(100));
+    CHECK(stall_count() == 0);
+
+    // held for several stall_ms, reported once
+    uint64_t deletes = test_obj::deletes.load();
+    pid_t tid = pin(proxy, milliseconds(300));
+    CHECK(wait_for([&] () { return test_obj::deletes.load() == deletes + 1; }));
+    CHECK(stall_count() == 1);
+    {
+        std::scoped_lock m(stalls_mutex);
+        if (!stalls.empty())
+        {
+            smr_stall stall = stalls[0];
+            CHECK(stall.tid == tid);
+            CHECK(stall.thread_name == "stall_reader");
+            CHECK(stall.duration >= milliseconds(50) && stall.duration < milliseconds(300));
+            CHECK((uint64_t) stall.epoch != 0);
+            CHECK(stall.deferred >= 1);
+        }
+    }
+
+    // a later stall is reported again
+    pin(proxy, milliseconds(300));
+    CHECK(wait_for([&] () { return stall_count() == 2; }));
+
+    return test_result("stall_test");
+}
+
+/*-*/
@@ -0,0 +1,182 @@
+/*
+   Copyright 2024 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+ * smr_stats_page publish and smr_stats_view read, incl. reads
+ * racing updates and an update left in progress, and
+ * smr_metrics_rates
+ */
+
+#include "smrtest.h"
+
+#include <smrmetrics.h>
+
+#include <stdexcept>
+
+using namespace std::chrono;
+
+/**
+ * snapshot w/ every word set to value, so a torn copy has words
+ * that differ
+ */
+static smr_metrics uniform(uint64_t value)
+{
+    uint64_t words[smr_stats_layout::words];
+    for (uint64_t& word : words)
+        word = value;
+    smr_metrics metrics;
+    memcpy(&metrics, words, sizeof(metrics));
+    return metrics;
+}
+
+static bool is_uniform(const smr_metrics& metrics)
+{
+    uint64_t words[smr_stats_layout::words];
+    memcpy(words, &metrics, sizeof(words));
+    for (uint64_t word : words)
+        if (word != words[0])
+            return false;
+    return true;
+}
+
+static void test_rates()
+{
+    smr_metrics before = {};
+    smr_metrics after = {};
+    before.timestamp_ns = 1'000'000'000;
+    after.timestamp_ns = 3'000'000'000;     // 2 secs
+    before.retired = 100;
+    after.retired = 1100;
+    before.deleted = 50;
+    after.deleted = 550;
+    before.passes = 10;
+    after.passes = 20;
+    after.scan_ns = 1000;
+    after.sync_ns = 2000;
+    before.delete_ns = 500;
+    after.delete_ns = 3500;
+
+    smr_metrics_rates rates(before, after);
+    CHECK(rates.retires == 500);
+    CHECK(rates.deletes == 250);
+    CHECK(rates.passes == 5);
+    CHECK(rates.scan_ns == 100);
+    CHECK(rates.sync_ns == 200);
+    CHECK(rates.delete_ns == 300);
+
+    // same snapshot, no interval or passes
+    smr_metrics_rates none(after, after);
+    CHECK(none.retires == 0 && none.deletes == 0 && none.passes == 0);
+    CHECK(none.scan_ns == 0 && none.sync_ns == 0 && none.delete_ns == 0);
+}
+
+int main()
+{
+    test_rates();
+
+    char name[64];
+    snprintf(name, sizeof(name), "/stats_test.%d", (int) getpid());
+
+    // no page
+    bool missing = false;
+    try {
+        smr_stats_view view(name);
+    }
+    catch (std::system_error&) {
+        missing = true;
+    }
+    CHECK(missing);
+
+    {
+        smr_stats_page page(name);
+        smr_stats_view view(name);
+        CHECK(view.pid() == getpid());
+
+        // nothing published yet
+        smr_metrics metrics;
+        CHECK(!view.read(metrics));
+
+        smr_metrics published = uniform(0);
+        published.timestamp_ns = 12345;
+        published.retired = 7;
+        published.latency[smr_metrics::latency_buckets - 1] = 3;
+        page.publish(published);
+        CHECK(view.read(metrics));
+        CHECK(memcmp(&metrics, &published, sizeof(metrics)) == 0);
+
+        // reads racing updates never see a torn copy
+        page.publish(uniform(0));
+        std::atomic_bool done = false;
+        std::thread publisher([&] () {
+            for (uint64_t value = 1; !done.load(std::memory_order_relaxed); value++)
+                page.publish(uniform(value));
+        });
+        uint64_t reads = 0;
+        uint64_t torn = 0;
+        auto deadline = steady_clock::now() + milliseconds(300);
+        while (steady_clock::now() < deadline)
+        {
+            if (!view.read(metrics))
+                continue;
+            reads++;
+            if (!is_uniform(metrics))
+                torn++;
+        }
+        done.store(true);
+        publisher.join();
+        CHECK(reads > 0);
+        CHECK(torn == 0);
+
+        // publisher died mid update, seq left odd
+        int fd = shm_open(name, O_RDWR, 0);
+        void* mem = fd >= 0 ? mmap(nullptr, sizeof(smr_stats_layout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+        CHECK(mem != MAP_FAILED);
+        if (fd >= 0)
+            close(fd);
+        if (mem != MAP_FAILED)
+        {
+            smr_stats_layout* layout = (smr_stats_layout*) mem;
+            uint64_t seq = layout->seq.load();
+            layout->seq.store(seq | 1);
+            CHECK(!view.read(metrics));
+            layout->seq.store((seq | 1) + 1);
+            CHECK(view.read(metrics));
+
+            // layout mismatch
+            layout->size = sizeof(smr_metrics) - sizeof(uint64_t);
+            CHECK(!view.read(metrics));
+            layout->size = sizeof(smr_metrics);
+            munmap(mem, sizeof(smr_stats_layout));
+        }
+    }
+
+    // published by a domain's reclaim thread
+    {
+        smr_stats_page page(name);
+        smr_stats_view view(name);
+        smrproxy proxy(smrproxy_config{.wait_ms = 2, .stats_page = &page});
+        for (int ndx = 0; ndx < 10; ndx++)
+            proxy.retire(new test_obj(ndx));
+
+        smr_metrics metrics = {};
+        CHECK(wait_for([&] () { return view.read(metrics) && metrics.deleted >= 10; }));
+        CHECK(metrics.retired >= metrics.deleted && metrics.passes > 0);
+    }
+
+    return test_result("stats_test");
+}
+
+/*-*/
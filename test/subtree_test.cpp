@@ -0,0 +1,127 @@
+/*
+   Copyright 2024 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+ * retire_subtree() from destructors, whole trees freed in their
+ * root's reclaim pass, outside a destructor same as retire()
+ */
+
+#include "smrtest.h"
+
+#include <vector>
+
+using namespace std::chrono;
+
+static smrproxy* domain = nullptr;
+
+/**
+ * tree node, releases its children w/ retire_subtree(), records
+ * the batch expiry each node was deleted w/
+ */
+struct tree_node : public smr_obj_base
+{
+    inline static std::atomic<uint64_t> deletes = 0;
+    inline static std::vector<uint64_t> expiries;      // reclaim thread only
+
+    std::vector<tree_node*> children;
+
+    ~tree_node() override
+    {
+        expiries.push_back(expiry.load(std::memory_order_relaxed));
+        for (tree_node* child : children)
+            domain->retire_subtree(child);
+        deletes.fetch_add(1);
+    }
+};
+
+/**
+ * complete tree of depth levels w/ fanout children per node
+ * @param count returns number of nodes
+ */
+static tree_node* make_tree(uint32_t depth, uint32_t fanout, uint64_t& count)
+{
+    tree_node* node = new tree_node();
+    count++;
+    if (depth > 1)
+        for (uint32_t ndx = 0; ndx < fanout; ndx++)
+            node->children.push_back(make_tree(depth - 1, fanout, count));
+    return node;
+}
+
+/**
+ * retire root, wait for count nodes deleted
+ * @return true if all nodes deleted w/ the root's batch expiry
+ */
+static bool one_pass(smrproxy& proxy, tree_node* root, uint64_t count)
+{
+    uint64_t deletes = tree_node::deletes.load();
+    proxy.retire(root);
+    CHECK(wait_for([&] () { return tree_node::deletes.load() == deletes + count; }));
+
+    std::vector<uint64_t> expiries;
+    expiries.swap(tree_node::expiries);     // reclaim thread done
+    CHECK(expiries.size() == count);
+    for (uint64_t expiry : expiries)
+        if (expiry != expiries[0])
+            return false;
+    return true;
+}
+
+int main()
+{
+    smrproxy proxy(smrproxy_config{.wait_ms = 2});
+    domain = &proxy;
+
+    // depth 10 binary tree
+    {
+        uint64_t count = 0;
+        tree_node* root = make_tree(10, 2, count);
+        CHECK(one_pass(proxy, root, count));
+    }
+
+    // depth 10000 chain, deleted w/o recursing per level
+    {
+        uint64_t count = 0;
+        tree_node* root = make_tree(10000, 1, count);
+        CHECK(one_pass(proxy, root, count));
+    }
+
+    // outside a destructor, waits for a grace period like retire()
+    {
+        uint64_t deletes = tree_node::deletes.load();
+        std::atomic_bool locked = false;
+        std::atomic_bool release = false;
+        std::thread reader([&] () {
+            std::scoped_lock m(proxy);
+            locked.store(true);
+            wait_for([&] () { return release.load(); });
+        });
+        wait_for([&] () { return locked.load(); });
+
+        proxy.retire_subtree(new tree_node());
+        std::this_thread::sleep_for(milliseconds(20));
+        CHECK(tree_node::deletes.load() == deletes);
+
+        release.store(true);
+        reader.join();
+        CHECK(wait_for([&] () { return tree_node::deletes.load() == deletes + 1; }));
+        tree_node::expiries.clear();
+    }
+
+    return test_result("subtree_test");
+}
+
+/*-*/
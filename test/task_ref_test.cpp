@@ -0,0 +1,123 @@
+/*
+   Copyright 2024 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+ * smr_task_ref locked on one thread and unlocked on another, moved
+ * while locked, and unlocked by move assignment and destruction
+ */
+
+#include "smrtest.h"
+
+using namespace std::chrono;
+
+/**
+ * retire an object and check it is held back while pinned
+ * @return deletes count to wait for once unpinned
+ */
+static uint64_t retire_pinned(smrproxy& proxy)
+{
+    uint64_t deletes = test_obj::deletes.load();
+    proxy.retire(new test_obj());
+    std::this_thread::sleep_for(milliseconds(20));
+    CHECK(test_obj::deletes.load() == deletes);
+    return deletes + 1;
+}
+
+static bool deleted(uint64_t deletes)
+{
+    return wait_for([&] () { return test_obj::deletes.load() == deletes; });
+}
+
+int main()
+{
+    smrproxy proxy(smrproxy_config{.wait_ms = 2});
+
+    // locked on one thread, moved while locked, unlocked on another
+    {
+        smr_task_ref ref(proxy);
+        ref.lock();
+        CHECK(ref.locked());
+        uint64_t deletes = retire_pinned(proxy);
+
+        std::thread thread([ref = std::move(ref)] () mutable {
+            std::this_thread::sleep_for(milliseconds(20));
+            ref.unlock();
+        });
+        CHECK(!ref.locked());
+        thread.join();
+        CHECK(deleted(deletes));
+    }
+
+    // independent of the thread's own read lock
+    {
+        smr_task_ref ref(proxy);
+        {
+            std::scoped_lock m(ref);
+            {
+                std::scoped_lock m2(proxy);
+            }
+            uint64_t deletes = retire_pinned(proxy);
+            ref.unlock();
+            CHECK(deleted(deletes));
+            ref.lock();
+        }
+        CHECK(!ref.locked());
+    }
+
+    // move assignment onto a locked ref unlocks it
+    {
+        smr_task_ref ref(proxy);
+        smr_task_ref unlocked(proxy);
+        ref.lock();
+        uint64_t deletes = retire_pinned(proxy);
+        ref = std::move(unlocked);
+        CHECK(!ref.locked());
+        CHECK(deleted(deletes));
+    }
+
+    // destruction unlocks
+    {
+        uint64_t deletes;
+        {
+            smr_task_ref ref(proxy);
+            ref.lock();
+            deletes = retire_pinned(proxy);
+        }
+        CHECK(deleted(deletes));
+    }
+
+    // slots cycled through thread caches by many tasks on several threads
+    {
+        uint64_t deletes = test_obj::deletes.load();
+        std::vector<std::thread> threads;
+        for (int ndx = 0; ndx < 4; ndx++)
+            threads.emplace_back([&] () {
+                for (int count = 0; count < 1000; count++)
+                {
+                    smr_task_ref ref(proxy);
+                    std::scoped_lock m(ref);
+                    proxy.retire(new test_obj(count));
+                }
+            });
+        for (auto& thread : threads)
+            thread.join();
+        CHECK(deleted(deletes + 4000));
+    }
+
+    return test_result("task_ref_test");
+}
+
+/*-*/
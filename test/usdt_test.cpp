@@ -0,0 +1,86 @@
+/*
+   Copyright 2024 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+ * PROXY_PROBE tracepoints in smrproxy and arcproxy, built w/o and,
+ * where <sys/sdt.h> is available, w/ PROXY_USDT.  W/o PROXY_USDT
+ * probes and their arguments compile away.
+ */
+
+#include "smrtest.h"
+
+#include <arcproxy.h>
+
+#if defined(PROXY_USDT) && !defined(STAP_PROBEV)
+#error "PROXY_USDT w/o <sys/sdt.h> probes"
+#endif
+
+static int evaluated = 0;
+
+static uint64_t probe_arg()
+{
+    evaluated++;
+    return 0;
+}
+
+struct arc_test_obj : public arc_obj_base
+{
+    inline static std::atomic<uint64_t> deletes = 0;
+
+    ~arc_test_obj() override
+    {
+        deletes.fetch_add(1);
+    }
+};
+
+int main()
+{
+    PROXY_PROBE(usdt_test, probe, probe_arg());
+#ifndef PROXY_USDT
+    CHECK(evaluated == 0);
+#endif
+
+    // smrproxy retire, reclaim, sync and delete_objects probes
+    {
+        smrproxy proxy(smrproxy_config{.wait_ms = 2});
+        uint64_t deletes = test_obj::deletes.load();
+        for (int ndx = 0; ndx < 10; ndx++)
+        {
+            std::scoped_lock m(proxy);
+            proxy.retire(new test_obj(ndx));
+        }
+        proxy.synchronize();
+        CHECK(wait_for([&] () { return test_obj::deletes.load() == deletes + 10; }));
+    }
+
+    // arcproxy reclaim and add_tail probes
+    {
+        arcproxy proxy(20);
+        arc_ref_t* ref = proxy.acquire_ref();
+        for (int ndx = 0; ndx < 10; ndx++)
+        {
+            ref->lock();
+            proxy.retire(new arc_test_obj());
+            ref->unlock();
+        }
+        proxy.release_ref(ref);
+        CHECK(arc_test_obj::deletes.load() > 0);
+    }
+
+    return test_result("usdt_test");
+}
+
+/*-*/
@@ -0,0 +1,82 @@
+/*
+   Copyright 2024 Joseph W. Seigh
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+/*
+ * reclaim wake up latency after a reader pinning reclaim unlocks
+ */
+
+#include "smrtest.h"
+
+using namespace std::chrono;
+
+/**
+ * hold a read lock for hold, retire an object meanwhile
+ * @return time from unlock to delete
+ */
+static milliseconds unlock_to_delete(smrproxy& proxy, milliseconds hold)
+{
+    uint64_t deletes = test_obj::deletes.load();
+    std::atomic_bool locked = false;
+    steady_clock::time_point unlocked;
+
+    std::thread reader([&] () {
+        smr_ref* ref = proxy.acquire_ref();
+        ref->lock();
+        locked.store(true);
+        std::this_thread::sleep_for(hold);
+        unlocked = steady_clock::now();
+        ref->unlock();
+        proxy.release_ref(ref);
+    });
+
+    wait_for([&] () { return locked.load(); });
+    proxy.retire(new test_obj());
+    reader.join();
+
+    CHECK(wait_for([&] () { return test_obj::deletes.load() > deletes; }));
+    return duration_cast<milliseconds>(steady_clock::now() - unlocked);
+}
+
+int main()
+{
+    // defaults, no backoff past wait_ms while reader pins reclaim
+    {
+        smrproxy proxy;
+        milliseconds latency = unlock_to_delete(proxy, milliseconds(1600));
+        fprintf(stdout, "default config, unlock to delete = %ld ms\n", (long) latency.count());
+        CHECK(latency < milliseconds(400));
+    }
+
+    // unlock hint wakes reclaim thread before poll interval
+    {
+        smrproxy proxy(smrproxy_config{.wait_ms = 2000, .unlock_hint = true});
+        milliseconds latency = unlock_to_delete(proxy, milliseconds(200));
+        fprintf(stdout, "unlock_hint, wait_ms=2000, unlock to delete = %ld ms\n", (long) latency.count());
+        CHECK(latency < milliseconds(1000));
+    }
+
+    // unlock of a ref that isn't locked never matches the idle hint
+    {
+        smr_ref ref;
+        _smr_no_wakeup.state.store(smr_wakeup::idle);
+        uint32_t seq = _smr_no_wakeup.seq.load();
+        ref.unlock();
+        CHECK(_smr_no_wakeup.seq.load() == seq);
+        _smr_no_wakeup.state.store(smr_wakeup::awake);
+    }
+
+    return test_result("wakeup_test");
+}